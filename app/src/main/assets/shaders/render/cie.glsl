@@ -0,0 +1,33 @@
+// Analytic fits of the CIE 1931 color matching functions, by wavelength in nanometers
+
+float xFit_1931(float lambda){
+    float tmp1 = (lambda-595.8f)/33.33f;
+    float tmp2 = (lambda-446.8f)/19.44f;
+    return 1.065f * exp(-0.5f * tmp1 * tmp1) + 0.366f * exp(-0.5f * tmp2 * tmp2);
+}
+float yFit_1931(float lambda){
+    float tmp = (log(lambda) - log(556.3f))/0.075f;
+    return 1.014 * exp(-0.5f * tmp * tmp);
+}
+float zFit_1931(float lambda){
+    float tmp = (log(lambda) - log(449.8f))/0.051f;
+    return 1.839  * exp(-0.5f * tmp * tmp);
+}
+
+
+float xDFit_1931(float wave){
+    float t1 = (wave-442.0f)*((wave<442.0f)?0.0624f:0.0374f);
+    float t2 = (wave-599.8f)*((wave<599.8f)?0.0264f:0.0323f);
+    float t3 = (wave-501.1f)*((wave<501.1f)?0.0490f:0.0382f);
+    return 0.362f*exp(-0.5f*t1*t1) + 1.056f*exp(-0.5f*t2*t2) - 0.065f*exp(-0.5f*t3*t3);
+}
+float yDFit_1931(float wave){
+    float t1 = (wave-568.8f)*((wave<568.8f)?0.0213f:0.0247f);
+    float t2 = (wave-530.9f)*((wave<530.9f)?0.0613f:0.0322f);
+    return 0.821f*exp(-0.5f*t1*t1) + 0.286f*exp(-0.5f*t2*t2);
+}
+float zDFit_1931(float wave){
+    float t1 = (wave-437.0f)*((wave<437.0f)?0.0845f:0.0278f);
+    float t2 = (wave-459.0f)*((wave<459.0f)?0.0385f:0.0725f);
+    return 1.217f*exp(-0.5f*t1*t1) + 0.681f*exp(-0.5f*t2*t2);
+}
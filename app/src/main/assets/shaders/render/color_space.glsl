@@ -0,0 +1,18 @@
+// Matrices for chromatic adaptation in LMS space and for converting XYZ to linear sRGB
+
+const mat3 inversM = mat3(
+1.86007f, -1.12948f, 0.219898f,
+0.361223f, 0.638804f, -0.0000071275f,
+0.0f, 0.0f, 1.08909f
+);
+
+const mat3 M = mat3(
+0.4002f, 0.7076f, -0.0808f,
+-0.2263f, 1.1653f, 0.0457f,
+0.0f, 0.0f, 0.9182f
+);
+
+const mat3 RGB = mat3(
+3.2406f, -1.5372f, -0.4986f,
+-0.9689f, 1.8758f, 0.0415,
+0.0557f, -0.2040f, 1.0570f);
@@ -13,22 +13,34 @@ in vec2 texCoord;
 
 out vec4 outColor;
 
-const mat3 inversM = mat3(
-1.86007f, -1.12948f, 0.219898f,
-0.361223f, 0.638804f, -0.0000071275f,
-0.0f, 0.0f, 1.08909f
-);
-
-const mat3 M = mat3(
-0.4002f, 0.7076f, -0.0808f,
--0.2263f, 1.1653f, 0.0457f,
-0.0f, 0.0f, 0.9182f
-);
-
-const mat3 RGB = mat3(
-3.2406f, -1.5372f, -0.4986f,
--0.9689f, 1.8758f, 0.0415,
-0.0557f, -0.2040f, 1.0570f);
+#include "color_space.glsl"
+
+// Difference in alpha at which the texels of the ray marched image mostly stop being blended together when upsampled
+#define ALPHA_SIGMA 0.1f
+
+// Upsamples the ray marched image like bilinear filtering, except that each texel is weighted down by how much its
+// alpha differs from the closest texel, so that the edges of the fire stay sharp at lower ray marching resolutions
+vec4 upsample(vec2 uv){
+    ivec2 size = textureSize(LMS, 0);
+    vec2 position = uv * vec2(size) - 0.5f;
+    ivec2 base = ivec2(floor(position));
+    vec2 f = position - floor(position);
+
+    vec4 closest = texelFetch(LMS, clamp(ivec2(floor(position + 0.5f)), ivec2(0), size - 1), 0);
+
+    vec4 sum = vec4(0.0f);
+    float weights = 0.0f;
+    for (int y = 0; y <= 1; y++){
+        for (int x = 0; x <= 1; x++){
+            vec4 texel = texelFetch(LMS, clamp(base + ivec2(x, y), ivec2(0), size - 1), 0);
+            float bilinear = (x == 0 ? 1.0f - f.x : f.x) * (y == 0 ? 1.0f - f.y : f.y);
+            float weight = bilinear * exp(-abs(texel.a - closest.a) / ALPHA_SIGMA);
+            sum += weight * texel;
+            weights += weight;
+        }
+    }
+    return sum / weights;
+}
 
 vec3 gamma_correction(vec3 rgb){
 
@@ -62,7 +74,7 @@ void main() {
 
     vec4 max_LMS = texelFetch(max_LMS_tex, ivec2(0, 0), 0);
 
-    vec4 color = texture(LMS, texCoord).rgba;
+    vec4 color = upsample(texCoord);
     // Color space = vec3(1.8, 2.2, 2.2)
     color.rgb = max(pow(XYZ_to_RGB(color.rgb, max_LMS.xyz), colorSpace), vec3(0.2)) * filterColor;
 
@@ -1,6 +1,8 @@
 #version 310 es
 layout(location = 0) in vec3 pos;
-uniform mat4 mvp;
+layout(std140, binding = 0) uniform Camera {
+    mat4 mvp;
+};
 out vec3 hit;
 void main() {
     gl_Position = mvp * vec4(pos, 1.0);
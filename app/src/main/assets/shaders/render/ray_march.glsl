@@ -0,0 +1,134 @@
+// Ray marching through the substance, shared by the fragment shader of the box and the compute shader of the tiles
+// Bricks where the density is at most EMPTY_DENSITY have no visible fire, and are leapt over
+
+layout(binding = 2) uniform sampler3D substance; // density in x, temperature in y
+layout(binding = 3) uniform sampler3D brickMax; // maximum density and temperature of each brick of the substance
+layout(binding = 4) uniform sampler2D emission; // radiance in XYZ emitted at each temperature up to maxTemperature
+layout(binding = 5) uniform sampler3D substanceMips; // substance averaged over 2, 4, 8.. cells in each level
+
+// Length of the steps along the ray, in cells of the substance
+uniform float stepSize;
+// Offset of the first sample of this frame, as a part of a step, which is added to the offset of each pixel
+uniform float frameJitter;
+// Transmittance below which the rest of the ray can't be seen
+uniform float transmittanceThreshold;
+// Temperature of the last texel of the emission table
+uniform float maxTemperature;
+// The temperatures that the temperature channel maps 0 and 1 to, which is 0 and 1 unless it is an 8 bit copy
+uniform vec2 temperatureRange;
+// Level of detail to sample the substance at, from how many cells a pixel covers, where 1 is the first averaged level
+uniform float lod;
+
+// The step length that the opacity of a sample is given for
+#define REFERENCE_STEP (1.0f / 42.0f)
+
+// Returns the black-body radiation in XYZ, emitted per unit of density and length at the temperature T, which is
+// interpolated between the two closest temperatures of the table
+vec3 black_body_radiation(float T){
+    int size = textureSize(emission, 0).x;
+    float x = clamp(T / maxTemperature, 0.0f, 1.0f) * float(size - 1);
+    int i = min(int(x), size - 2);
+    vec3 low = texelFetch(emission, ivec2(i, 0), 0).xyz;
+    vec3 high = texelFetch(emission, ivec2(i + 1, 0), 0).xyz;
+    return mix(low, high, x - float(i));
+}
+
+// Returns the density and temperature at the position, averaged over about as many cells as a pixel covers
+vec2 sample_substance(vec3 position){
+    if (lod <= 0.0f)
+        return texture(substance, position).xy;
+    vec2 averaged = textureLod(substanceMips, position, max(lod - 1.0f, 0.0f)).xy;
+    if (lod >= 1.0f)
+        return averaged;
+    return mix(texture(substance, position).xy, averaged, lod);
+}
+
+// Returns how much of the light passes through a sample with the given density, over dx
+float transmittance(float density, float dx){
+    float absorbtion = 1.0f * density;// todo what value
+    float scattering  = 0.0f;// todo
+    float tot = absorbtion + scattering;
+    return exp(-tot * dx);
+}
+
+// Returns a value between 0 and 1 that varies from pixel to pixel without a visible pattern
+float jitter(vec2 pixel){
+    return fract(52.9829189f * fract(dot(pixel, vec2(0.06711056f, 0.00583715f))));
+}
+
+// Returns the distance along the direction from the position to where it leaves the box from 0 to 1
+float box_exit(vec3 position, vec3 direction){
+    vec3 bound = step(0.0f, direction);
+    vec3 distances = abs(bound - position) / max(abs(direction), vec3(1e-6f));
+    return min(min(distances.x, distances.y), distances.z);
+}
+
+// Returns the distance along the direction from the position to where it leaves its brick
+float brick_exit(vec3 position, vec3 direction, vec3 bricks){
+    vec3 brick = floor(position * bricks);
+    vec3 bound = (brick + step(0.0f, direction)) / bricks;
+    return min(min(abs(bound.x - position.x) / max(abs(direction.x), 1e-6f),
+                   abs(bound.y - position.y) / max(abs(direction.y), 1e-6f)),
+               abs(bound.z - position.z) / max(abs(direction.z), 1e-6f));
+}
+
+// Marches the ray from where it enters the box, in the direction, for the distance D through the box, and returns
+// the radiance in XYZ that reaches the camera and the opacity. The pixel decides where the first sample is
+vec4 march(vec3 entry, vec3 direction, float D, vec2 pixel){
+
+    vec4 color = vec4(0.0f, 0.0f, 0.0f, 0.0f);
+    color.a = 0.0f;
+
+    // The ray is marched from the camera, so that it can stop once the rest of it is hidden. The first sample is
+    // moved by a part of a step that differs between neighbouring pixels, which turns banding into noise
+    float h = stepSize / length(direction * vec3(textureSize(substance, 0)));
+    float t = h * fract(jitter(pixel) + frameJitter);
+    vec3 tr = entry + direction * t;
+    vec3 rayStep = direction * h;
+
+    vec3 XYZ = vec3(0.0f);
+    float light = 1.0f;
+
+    ivec3 bricks = textureSize(brickMax, 0);
+
+    for (; t<=D; t+=h){
+        // Samples without density don't change the radiance or alpha, so the samples in an empty brick are skipped,
+        // up to the last one before the brick is left, which keeps the remaining samples where they were
+        vec2 bounds = texelFetch(brickMax, min(ivec3(tr * vec3(bricks)), bricks - 1), 0).xy;
+        if (bounds.x <= EMPTY_DENSITY){
+            float skipped = floor(brick_exit(tr, direction, vec3(bricks)) / h);
+            t += skipped * h;
+            tr += rayStep * (skipped + 1.0f);
+            continue;
+        }
+
+        vec2 value = sample_substance(tr);
+
+        float alpha = clamp(value.x, 0.0, 1.0);
+        //float alpha = 0.5;
+
+        float temp = mix(temperatureRange.x, temperatureRange.y, value.y);
+        //float temp = 2000.0f;
+
+        // The density absorbs and emits, and what it emits is dimmed by what is in front of it
+        float absorbtion = 1.0f * alpha;// todo what value
+        XYZ += light * absorbtion * h * black_body_radiation(temp);
+        light *= transmittance(alpha, h);
+
+        // The opacity is given for a step of REFERENCE_STEP, and is scaled to the actual step
+        alpha = 1.0f - pow(1.0f - pow(alpha, 2.0), h / REFERENCE_STEP);
+
+        float over = alpha + color.a * (1.0 - alpha);
+
+        color.a = over;
+
+        if (light < transmittanceThreshold && color.a > 1.0f - transmittanceThreshold)
+            break;
+
+        tr += rayStep;
+    }
+
+    color.xyz = XYZ;
+
+    return color;
+}
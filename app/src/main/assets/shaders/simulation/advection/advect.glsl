@@ -0,0 +1,74 @@
+// Advects the data field along the velocity field, both declared by the including shader together with the
+// parameters of the advection (dt, meterToVoxels and gridSize)
+// With MACCORMACK defined, the semi-lagrangian advection of the data has already been written to forward_field,
+// and is corrected here by half of the difference between the data and that result traced forward in time.
+// The correction is limited to the range of the data cells that the semi-lagrangian result was interpolated from,
+// which keeps it from overshooting where the field isn't smooth.
+// With FUSED defined, the including shader declares data_at(), which returns the data of a cell with the fused
+// stages applied, and the data is interpolated from it instead of being filtered by the texture unit. With
+// SELF_ADVECTION also defined, the data is the velocity field, which is then traced back by data_at() as well
+#ifdef MACCORMACK
+layout(binding = 5) uniform sampler3D forward_field;
+#endif
+
+#ifdef FUSED
+// Interpolates the data at the position in pixels linearly, like a texture with clamped edges would
+vec3 sample_data(vec3 position) {
+    vec3 cell = position - vec3(0.5);
+    ivec3 base = ivec3(floor(cell));
+    vec3 f = cell - floor(cell);
+    ivec3 last = textureSize(data_field, 0) - 1;
+    vec3 result = vec3(0.0f);
+    for (int i = 0; i < 8; i++) {
+        ivec3 corner = ivec3(i & 1, (i >> 1) & 1, i >> 2);
+        vec3 weights = mix(vec3(1.0f) - f, f, vec3(corner));
+        result += weights.x * weights.y * weights.z * data_at(clamp(base + corner, ivec3(0), last));
+    }
+    return result;
+}
+#else
+vec3 data_at(ivec3 position) {
+    return texelFetch(data_field, position, 0).xyz;
+}
+
+vec3 sample_data(vec3 position) {
+    // Note: Linear interpolation due to linear texture
+    return texture(data_field, position / gridSize).xyz;
+}
+#endif
+
+vec3 advect(ivec3 position) {
+
+    // Get velocity at a specific position in the velocity field
+#ifdef SELF_ADVECTION
+    // The data is the velocity, which moves itself with the fused stages applied to it
+    vec3 velocity = data_at(position);    //velocity in meters/second
+#else
+    vec3 velocity = texelFetch(velocity_field, position, 0).xyz;    //velocity in meters/second
+#endif
+    vec3 offset = dt * velocity * meterToVoxels;    //offset in pixels
+
+    // Location of the previous position, back in time
+    vec3 previous_position = vec3(position) + vec3(0.5) - offset;  //position in pixels
+
+#ifndef MACCORMACK
+    return sample_data(previous_position);
+#else
+    vec3 forward = texelFetch(forward_field, position, 0).xyz;
+    // The forward result advected back again, which differs from the data by twice the error of advection
+    vec3 backward = texture(forward_field, (vec3(position) + vec3(0.5) + offset) / gridSize).xyz;
+    vec3 corrected = forward + 0.5 * (data_at(position) - backward);
+
+    ivec3 base = ivec3(floor(previous_position - 0.5));
+    ivec3 last = textureSize(data_field, 0) - 1;
+    vec3 minimum = vec3(3.0e38);
+    vec3 maximum = vec3(-3.0e38);
+    for (int i = 0; i < 8; i++) {
+        ivec3 corner = clamp(base + ivec3(i & 1, (i >> 1) & 1, i >> 2), ivec3(0), last);
+        vec3 value = data_at(corner);
+        minimum = min(minimum, value);
+        maximum = max(maximum, value);
+    }
+    return clamp(corrected, minimum, maximum);
+#endif
+}
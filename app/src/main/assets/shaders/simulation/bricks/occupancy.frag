@@ -0,0 +1,39 @@
+#version 310 es
+
+precision highp float;
+precision highp sampler3D;
+
+layout(binding = 0) uniform sampler3D substance_field;
+layout(binding = 1) uniform sampler3D velocity_field;
+layout(binding = 2) uniform sampler3D source_field;
+
+uniform vec3 thresholds;    // density, temperature and speed (in meters/second) above which a cell is occupied
+uniform int depth;
+
+out float outData;
+
+// Sets each brick, which is a cell of this field, to 1 if any of the BRICK_SIZE^3 cells that it covers of the
+// substance resolution is occupied or has a source, and to 0 otherwise
+void main() {
+
+    ivec3 brick = ivec3(gl_FragCoord.xy, depth);
+    ivec3 first = brick * BRICK_SIZE;
+    ivec3 last = min(first + BRICK_SIZE, textureSize(substance_field, 0));
+
+    outData = 0.0;
+    for (int z = first.z; z < last.z; z++) {
+        for (int y = first.y; y < last.y; y++) {
+            for (int x = first.x; x < last.x; x++) {
+                ivec3 cell = ivec3(x, y, z);
+                vec2 substance = texelFetch(substance_field, cell, 0).xy;
+                vec2 source = texelFetch(source_field, cell, 0).xy;
+                float speed = length(texelFetch(velocity_field, cell, 0).xyz);
+                if (substance.x > thresholds.x || substance.y > thresholds.y || speed > thresholds.z
+                        || source != vec2(0.0)) {
+                    outData = 1.0;
+                    return;
+                }
+            }
+        }
+    }
+}
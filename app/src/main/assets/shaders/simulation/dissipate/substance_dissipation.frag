@@ -0,0 +1,32 @@
+#version 310 es
+
+precision highp float;
+precision highp sampler3D;
+
+layout(binding = 0) uniform sampler3D substance_field;
+
+layout(std140, binding = 0) uniform Parameters {
+    float dt;
+    float dissipation_rate;
+};
+uniform int depth;
+
+out vec2 outSubstance;
+
+// Performs dissipation of the substance field, where the density (x) dissipates with the given rate and the
+// temperature (y) loses heat
+void main() {
+
+    ivec3 position = ivec3(gl_FragCoord.xy, depth);
+
+    vec2 substance = texelFetch(substance_field, position, 0).xy;
+
+    float density = substance.x / (1.0f + (dt * dissipation_rate));
+
+    float temperature = substance.y;
+    float ambient_temperature = 0.0f;
+    float max_temperature = 3500.0f;
+    float temperature_loss = pow((temperature - ambient_temperature) / (max_temperature - ambient_temperature), 4.0f);
+
+    outSubstance = vec2(density, temperature - dt * 3000.0f * temperature_loss);
+}
@@ -0,0 +1,14 @@
+// Specializes an operation for the type of field it is used with. With SCALAR_FIELD defined the values are floats,
+// so only the first channel is read and computed with, with PAIR_FIELD they are the two first channels (such as the
+// density and temperature of the substance), otherwise they are vectors.
+// Read values with texelFetch(...).FIELD_CHANNELS, which keeps the texture functions visible to the slab variants.
+#if defined(SCALAR_FIELD)
+#define field_t float
+#define FIELD_CHANNELS x
+#elif defined(PAIR_FIELD)
+#define field_t vec2
+#define FIELD_CHANNELS xy
+#else
+#define field_t vec3
+#define FIELD_CHANNELS xyz
+#endif
@@ -6,7 +6,9 @@ precision highp sampler3D;
 layout(binding = 0) uniform sampler3D target_field;
 layout(binding = 1) uniform sampler3D source_field;
 
-uniform float dt;
+layout(std140, binding = 0) uniform Parameters {
+    float dt;
+};
 uniform int depth;
 
 out vec3 outValue;
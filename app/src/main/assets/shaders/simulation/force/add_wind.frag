@@ -5,10 +5,12 @@ precision highp sampler3D;
 
 layout(binding = 0) uniform sampler3D target_field;
 
-uniform float dt;
+layout(std140, binding = 0) uniform Parameters {
+    float dt;
+    float wind_angle;
+    float wind_strength;
+};
 uniform int depth;
-uniform float wind_angle;
-uniform float wind_strength;
 
 out vec3 outValue;
 
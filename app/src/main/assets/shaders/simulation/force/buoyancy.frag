@@ -3,15 +3,17 @@
 precision highp float;
 precision highp sampler3D;
 
-layout(binding = 0) uniform sampler3D temperature_field;
+layout(binding = 0) uniform sampler3D substance_field; // the temperature is the second channel
 layout(binding = 1) uniform sampler3D velocity_field;
 
-uniform float dt;
+layout(std140, binding = 0) uniform Parameters {
+    float dt;
+    float scale;
+    vec3 temp_border_width;
+    vec3 gridSize;
+    vec3 direction;
+};
 uniform int depth;
-uniform float scale;
-uniform vec3 temp_border_width;
-uniform vec3 gridSize;
-uniform vec3 direction;
 
 out vec3 outVelocity;
 
@@ -30,7 +32,7 @@ void main() {
     // Texture coordinate for the temperature texture (with border)
     vec3 temp_tex_coord = temp_border_width + tex_without_border_coords*(vec3(1) - 2.0f*temp_border_width);
 
-    float temperature = texture(temperature_field, temp_tex_coord).x;
+    float temperature = texture(substance_field, temp_tex_coord).y;
     vec3 velocity = texelFetch(velocity_field, position, 0).xyz;
 
     //vec3 vertical_direction = vec3(0.0f, 1.0f, 0.0f);
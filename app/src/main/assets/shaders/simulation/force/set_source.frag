@@ -6,17 +6,19 @@ precision highp sampler3D;
 layout(binding = 0) uniform sampler3D target_field;
 layout(binding = 1) uniform sampler3D source_field;
 
-uniform float dt;
+layout(std140, binding = 0) uniform Parameters {
+    float dt;
+};
 uniform int depth;
 
-out float outValue;
+out vec3 outValue;
 
+// Sets each channel of the target texture to the source texture, where the source is not zero
 void main() {
     ivec3 position = ivec3(gl_FragCoord.xy, depth);
 
-    // todo vec3 support
-    float target = texelFetch(target_field, position, 0).x;
-    float source = texelFetch(source_field, position, 0).x;
+    vec3 target = texelFetch(target_field, position, 0).xyz;
+    vec3 source = texelFetch(source_field, position, 0).xyz;
 
-    outValue = (source == 0.0f) ? target : source;
+    outValue = mix(target, source, notEqual(source, vec3(0.0f)));
 }
\ No newline at end of file
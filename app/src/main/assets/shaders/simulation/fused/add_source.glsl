@@ -0,0 +1,6 @@
+layout(binding = 4) uniform sampler3D source_field;
+
+// Same as force/add_source.frag
+vec3 addSource(vec3 value, ivec3 position) {
+    return value + dt*texelFetch(source_field, position, 0).xyz;
+}
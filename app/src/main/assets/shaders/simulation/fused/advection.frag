@@ -0,0 +1,46 @@
+#version 310 es
+
+precision highp float;
+precision highp sampler3D;
+
+layout(binding = 0) uniform sampler3D velocity_field;
+layout(binding = 1) uniform sampler3D data_field;
+
+layout(std140, binding = 0) uniform Parameters {
+    float dt;   //in seconds
+    float meterToVoxels;  //conversion factor from meter to voxels
+    vec3 gridSize;  //grid size in pixels
+};
+uniform int depth;  //pixel layer that is updated
+
+// Result data from the advection and the fused stages
+out vec3 outData;
+
+// FUSED STAGES
+
+// Returns the data of the cell with the stages that come before advection applied to it, as the separate passes
+// would have written it before the advection read it
+vec3 data_at(ivec3 position) {
+    vec3 value = texelFetch(data_field, position, 0).xyz;
+
+    // FUSED SOURCES
+
+    return value;
+}
+
+#define FUSED
+#include "../advection/advect.glsl"
+
+//Performs the advection step like advection.frag, of the data with the sources and forces applied to each cell that
+//it is interpolated from, and then applies the stages that come after advection, such as dissipation, to the result
+//Each stage is a function (vec3 value, ivec3 position) -> vec3 from one of the files in this folder
+void main() {
+
+    ivec3 position = ivec3(gl_FragCoord.xy, depth); //position in pixels
+
+    vec3 value = advect(position);
+
+    // FUSED CALLS
+
+    outData = value;
+}
@@ -0,0 +1,20 @@
+layout(binding = 2) uniform sampler3D substance_field; // the temperature is the second channel
+
+layout(std140, binding = 1) uniform BuoyancyParameters {
+    float buoyancy_scale;
+    vec3 temp_border_width;
+    vec3 buoyancy_direction;
+};
+
+// Same as force/buoyancy.frag
+vec3 buoyancy(vec3 velocity, ivec3 position) {
+    float ambient_temperature = 0.0f;
+
+    vec3 voxel_center = vec3(position) + vec3(0.5);
+    vec3 tex_without_border_coords = (voxel_center - vec3(1))/(gridSize - vec3(2));
+    vec3 temp_tex_coord = temp_border_width + tex_without_border_coords*(vec3(1) - 2.0f*temp_border_width);
+
+    float temperature = texture(substance_field, temp_tex_coord).y;
+
+    return velocity + buoyancy_scale * (temperature - ambient_temperature) * buoyancy_direction * dt;
+}
@@ -0,0 +1,15 @@
+layout(std140, binding = 3) uniform DissipationParameters {
+    float dissipation_rate;
+};
+
+// Same as dissipate/substance_dissipation.frag
+vec3 dissipation(vec3 value, ivec3 position) {
+    float density = value.x / (1.0f + (dt * dissipation_rate));
+
+    float temperature = value.y;
+    float ambient_temperature = 0.0f;
+    float max_temperature = 3500.0f;
+    float temperature_loss = pow((temperature - ambient_temperature) / (max_temperature - ambient_temperature), 4.0f);
+
+    return vec3(density, temperature - dt * 3000.0f * temperature_loss, 0.0f);
+}
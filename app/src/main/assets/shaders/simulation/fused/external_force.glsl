@@ -0,0 +1,6 @@
+layout(binding = 3) uniform sampler3D force_field;
+
+// Same as force/external_force.frag
+vec3 externalForce(vec3 velocity, ivec3 position) {
+    return velocity + texelFetch(force_field, position, 0).xyz;
+}
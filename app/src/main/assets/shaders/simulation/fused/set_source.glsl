@@ -0,0 +1,7 @@
+layout(binding = 4) uniform sampler3D source_field;
+
+// Same as force/set_source.frag
+vec3 setSource(vec3 value, ivec3 position) {
+    vec3 source = texelFetch(source_field, position, 0).xyz;
+    return mix(value, source, notEqual(source, vec3(0.0f)));
+}
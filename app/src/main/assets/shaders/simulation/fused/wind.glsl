@@ -0,0 +1,9 @@
+layout(std140, binding = 2) uniform WindParameters {
+    float wind_angle;
+    float wind_strength;
+};
+
+// Same as force/add_wind.frag
+vec3 wind(vec3 velocity, ivec3 position) {
+    return velocity + dt*vec3(wind_strength*cos(wind_angle), 0, wind_strength*sin(wind_angle));
+}
@@ -8,7 +8,9 @@ layout(binding = 1) uniform sampler3D velocity_field;
 
 uniform int depth;
 // Distance between each grid element. Assumes that grid elements are cubical such that dh can be applied to all three axis
-uniform float dh;
+layout(std140, binding = 0) uniform Parameters {
+    float dh;
+};
 
 out vec3 outVelocity;
 
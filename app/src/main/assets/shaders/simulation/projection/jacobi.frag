@@ -3,14 +3,21 @@
 precision highp float;
 precision highp sampler3D;
 
+#include "../field.glsl"
+
 layout(binding = 0) uniform sampler3D x_field; // x vector (Ax = b)
 layout(binding = 1) uniform sampler3D b_field; // b vector (Ax = b)
 
 uniform int depth;
-uniform float alpha; // constant in jacobi formula
-uniform float beta; // constant in jacobi formula
+layout(std140, binding = 0) uniform Parameters {
+    field_t alpha; // constant in jacobi formula, for each channel
+    field_t beta; // constant in jacobi formula, for each channel
+};
+
+// With JACOBI_WEIGHT defined, the result is weighted against the previous value, which makes the iteration
+// damp the high frequencies of the error faster, as needed by a multigrid smoother
 
-out vec3 outData;
+out field_t outData;
 
 // Performs jacobi iteration to approximate solution to pressure equation
 void main() {
@@ -22,14 +29,18 @@ void main() {
     ivec3 dz = ivec3(0,0,1);
 
     // Use jacobi iteration formula
-    vec3 data;
-    data  = texelFetch(x_field, position - dx, 0).xyz;
-    data += texelFetch(x_field, position + dx, 0).xyz;
-    data += texelFetch(x_field, position - dy, 0).xyz;
-    data += texelFetch(x_field, position + dy, 0).xyz;
-    data += texelFetch(x_field, position - dz, 0).xyz;
-    data += texelFetch(x_field, position + dz, 0).xyz;
-    data += alpha * texelFetch(b_field, position, 0).xyz;
-
+    field_t data;
+    data  = texelFetch(x_field, position - dx, 0).FIELD_CHANNELS;
+    data += texelFetch(x_field, position + dx, 0).FIELD_CHANNELS;
+    data += texelFetch(x_field, position - dy, 0).FIELD_CHANNELS;
+    data += texelFetch(x_field, position + dy, 0).FIELD_CHANNELS;
+    data += texelFetch(x_field, position - dz, 0).FIELD_CHANNELS;
+    data += texelFetch(x_field, position + dz, 0).FIELD_CHANNELS;
+    data += alpha * texelFetch(b_field, position, 0).FIELD_CHANNELS;
+
+#ifdef JACOBI_WEIGHT
+    outData = mix(texelFetch(x_field, position, 0).FIELD_CHANNELS, data / beta, JACOBI_WEIGHT);
+#else
     outData = data / beta;
+#endif
 }
@@ -0,0 +1,32 @@
+#version 310 es
+
+precision highp float;
+precision highp sampler3D;
+
+layout(binding = 0) uniform sampler3D x_field; // solution on the fine field
+layout(binding = 1) uniform sampler3D correction_field; // correction on the coarse field
+
+uniform int depth;
+
+out float outData;
+
+// Adds the correction of the coarse field, interpolated trilinearly, to the solution on the fine field
+// The interpolation is done here since full precision fields can't be filtered on every device
+void main() {
+    ivec3 position = ivec3(gl_FragCoord.xy, depth);
+
+    // The center of fine cell f lies at texel f / 2 + 0.25 of the coarse field, both counting the border
+    vec3 coarse = vec3(position) * 0.5 + 0.25;
+    ivec3 base = ivec3(coarse);
+    vec3 t = coarse - vec3(base);
+    ivec3 last = textureSize(correction_field, 0) - 1;
+
+    float correction = 0.0;
+    for (int i = 0; i < 8; i++) {
+        ivec3 corner = ivec3(i & 1, (i >> 1) & 1, i >> 2);
+        vec3 weight = mix(1.0 - t, t, vec3(corner));
+        correction += weight.x * weight.y * weight.z * texelFetch(correction_field, min(base + corner, last), 0).x;
+    }
+
+    outData = texelFetch(x_field, position, 0).x + correction;
+}
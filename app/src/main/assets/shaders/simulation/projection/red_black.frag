@@ -0,0 +1,46 @@
+#version 310 es
+
+precision highp float;
+precision highp sampler3D;
+
+#include "../field.glsl"
+
+layout(binding = 0) uniform sampler3D x_field; // x vector (Ax = b)
+layout(binding = 1) uniform sampler3D b_field; // b vector (Ax = b)
+
+uniform int depth;
+layout(std140, binding = 0) uniform Parameters {
+    field_t alpha; // constant in jacobi formula, for each channel
+    field_t beta; // constant in jacobi formula, for each channel
+    float overRelaxation; // 1 for plain gauss-seidel, larger values step further towards the solution
+    int parity; // the cells whose coordinates sum to this parity are updated
+};
+
+out field_t outData;
+
+// Performs half of a red-black gauss-seidel iteration with over-relaxation (SOR), which updates the cells of one
+// color of a checkerboard. Their neighbours all have the other color, so the second half uses the updated values.
+void main() {
+    ivec3 position = ivec3(gl_FragCoord.xy, depth);
+
+    field_t current = texelFetch(x_field, position, 0).FIELD_CHANNELS;
+    if (((position.x + position.y + position.z) & 1) != parity) {
+        outData = current;
+        return;
+    }
+
+    ivec3 dx = ivec3(1,0,0);
+    ivec3 dy = ivec3(0,1,0);
+    ivec3 dz = ivec3(0,0,1);
+
+    field_t data;
+    data  = texelFetch(x_field, position - dx, 0).FIELD_CHANNELS;
+    data += texelFetch(x_field, position + dx, 0).FIELD_CHANNELS;
+    data += texelFetch(x_field, position - dy, 0).FIELD_CHANNELS;
+    data += texelFetch(x_field, position + dy, 0).FIELD_CHANNELS;
+    data += texelFetch(x_field, position - dz, 0).FIELD_CHANNELS;
+    data += texelFetch(x_field, position + dz, 0).FIELD_CHANNELS;
+    data += alpha * texelFetch(b_field, position, 0).FIELD_CHANNELS;
+
+    outData = mix(current, data / beta, overRelaxation);
+}
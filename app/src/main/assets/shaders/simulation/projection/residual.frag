@@ -0,0 +1,39 @@
+#version 310 es
+
+precision highp float;
+precision highp sampler3D;
+
+layout(binding = 0) uniform sampler3D x_field; // x vector (Ax = b)
+layout(binding = 1) uniform sampler3D b_field; // b vector (Ax = b)
+
+uniform int depth;
+// Distance between each grid element. Assumes that grid elements are cubical such that dh can be applied to all three axis
+layout(std140, binding = 0) uniform Parameters {
+    float dh;
+};
+
+out float outResidual;
+
+// Computes the residual b - Ax of the pressure equation, where A is the discrete laplacian
+// With ABSOLUTE_RESIDUAL its magnitude is computed instead, which is averaged to measure the convergence
+void main() {
+    ivec3 position = ivec3(gl_FragCoord.xy, depth);
+
+    ivec3 dx = ivec3(1,0,0);
+    ivec3 dy = ivec3(0,1,0);
+    ivec3 dz = ivec3(0,0,1);
+
+    float neighbours;
+    neighbours  = texelFetch(x_field, position - dx, 0).x;
+    neighbours += texelFetch(x_field, position + dx, 0).x;
+    neighbours += texelFetch(x_field, position - dy, 0).x;
+    neighbours += texelFetch(x_field, position + dy, 0).x;
+    neighbours += texelFetch(x_field, position - dz, 0).x;
+    neighbours += texelFetch(x_field, position + dz, 0).x;
+    float laplacian = (neighbours - 6.0 * texelFetch(x_field, position, 0).x) / (dh * dh);
+
+    outResidual = texelFetch(b_field, position, 0).x - laplacian;
+#ifdef ABSOLUTE_RESIDUAL
+    outResidual = abs(outResidual);
+#endif
+}
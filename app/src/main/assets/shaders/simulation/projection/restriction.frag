@@ -0,0 +1,28 @@
+#version 310 es
+
+precision highp float;
+precision highp sampler3D;
+
+layout(binding = 0) uniform sampler3D fine_field;
+
+uniform int depth;
+
+out float outData;
+
+// Averages the eight cells of the fine field that a cell of the coarse field covers
+// Interior cell c of the coarse field covers interior cells 2c - 1 and 2c of the fine field along each axis,
+// where the last one is left out when the fine interior has an odd size
+void main() {
+    ivec3 position = ivec3(gl_FragCoord.xy, depth);
+
+    ivec3 fine = 2 * position - 1;
+    ivec3 last = textureSize(fine_field, 0) - 2;
+
+    float sum = 0.0;
+    for (int i = 0; i < 8; i++) {
+        ivec3 offset = ivec3(i & 1, (i >> 1) & 1, i >> 2);
+        sum += texelFetch(fine_field, min(fine + offset, last), 0).x;
+    }
+
+    outData = 0.125 * sum;
+}
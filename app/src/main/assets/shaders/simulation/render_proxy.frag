@@ -0,0 +1,21 @@
+#version 310 es
+
+precision highp float;
+precision highp sampler3D;
+
+layout(binding = 0) uniform sampler3D substance;
+
+// The temperatures that are stored as 0 and 1
+uniform vec2 temperatureRange;
+
+uniform int depth;
+
+out vec2 outValue;
+
+// Writes the density and the temperature mapped to between 0 and 1 of the temperature range, for an 8 bit field
+void main() {
+    ivec3 position = ivec3(gl_FragCoord.xy, depth);
+
+    vec2 value = texelFetch(substance, position, 0).xy;
+    outValue = vec2(value.x, (value.y - temperatureRange.x) / (temperatureRange.y - temperatureRange.x));
+}
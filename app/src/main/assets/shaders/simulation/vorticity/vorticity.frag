@@ -6,9 +6,11 @@ precision highp sampler3D;
 layout(binding = 0) uniform sampler3D velocity_field;
 
 uniform int depth;
-uniform float dt;
-uniform float vorticityScale;
-uniform float dh;
+layout(std140, binding = 0) uniform Parameters {
+    float dt;
+    float vorticityScale;
+    float dh;
+};
 
 out vec3 outData;
 
@@ -4,6 +4,7 @@
 
 #include "fire.h"
 #include "util/file_loader.h"
+#include "util/program_cache.h"
 #include "settings.h"
 #include <android/asset_manager_jni.h>
 
@@ -15,10 +16,11 @@
 #define LOG_ERROR(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 #define LOG_INFO(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 
-Fire::Fire(JNIEnv* javaEnvironment, AAssetManager* assetManager, int width, int height)
+Fire::Fire(JNIEnv* javaEnvironment, AAssetManager* assetManager, const std::string& cacheDirectory, int width, int height)
     : javaEnvironment(javaEnvironment), assetManager(assetManager),
       screen_width(width), screen_height(height), shouldUpdateSettings(false), shouldRegenFields(false) {
     initFileLoader(assetManager);
+    initProgramCache(cacheDirectory);
 
     settings = new Settings();
 
@@ -34,7 +36,9 @@ int Fire::init() {
             ->withSourceDensity(0.4f)->withSourceRadius(8.0f)->withVelDiffusion(0.0f, 0)->withVorticityScale(8.0f)->withProjectIterations(20)
             ->withBuoyancyScale(0.15f)->withSmokeDissipation(0.0f)->withSmokeDiffusion(0.0f, 0)->withWindStrength(0.0f)
             ->withTempDiffusion(0.0f, 0)->withBackgroundColor(vec3(0.0f, 0.0f, 0.0f))->withFilterColor(vec3(1.0f, 1.0f, 1.0f))
-            ->withColorSpace(vec3(1.8f, 2.2f, 2.2f))->withName("Default")->withMinBand(2.0f)->withMaxBand(8.0f);
+            ->withColorSpace(vec3(1.8f, 2.2f, 2.2f))->withName("Default")->withMinBand(2.0f)->withMaxBand(8.0f)
+            ->withSlabBackend(SlabBackend::fragment)->withFieldLayout(Resolution::velocity, FieldLayout::volume)
+            ->withFieldLayout(Resolution::substance, FieldLayout::volume)->withOperatorFusion(true);
 
     settings->printInfo("FIRE");
 
@@ -46,7 +50,7 @@ void Fire::resize(int width, int height){
 }
 
 void Fire::update(){
-    GLuint density, temperature;
+    GLuint substance;
     ivec3 size;
 
     simulator->setRotation(-renderer->getRotation());
@@ -62,8 +66,8 @@ void Fire::update(){
         shouldRegenFields = false;
     }
 
-    simulator->update(density, temperature, size);
-    renderer->update(density, temperature, size);
+    simulator->update(substance, size);
+    renderer->update(substance, size);
 }
 
 void Fire::touch(double x, double y, double dx, double dy){
@@ -333,8 +337,11 @@ AAssetManager* loadAssetManager(JNIEnv *env, jobject assetManager) {
 
 
 // FireActivity
-JC(void) Java_com_pbf_FireActivity_init(JNIEnv* env, jobject , jobject mgr, jint width, jint height){
-    fire = new Fire(env, loadAssetManager(env, mgr), width, height);
+JC(void) Java_com_pbf_FireActivity_init(JNIEnv* env, jobject , jobject mgr, jstring cacheDirectory, jint width, jint height){
+    jboolean isCopy;
+    const char* directory = env->GetStringUTFChars(cacheDirectory, &isCopy);
+    fire = new Fire(env, loadAssetManager(env, mgr), directory, width, height);
+    env->ReleaseStringUTFChars(cacheDirectory, directory);
 }
 // FireRenderer
 JC(jint) Java_com_pbf_FireRenderer_init(JCT){
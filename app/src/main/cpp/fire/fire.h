@@ -49,7 +49,7 @@ public:
     JNIEnv* javaEnvironment;
     AAssetManager* assetManager;
 
-    Fire(JNIEnv* javaEnvironment, AAssetManager* assetManager, int width, int height);
+    Fire(JNIEnv* javaEnvironment, AAssetManager* assetManager, const std::string& cacheDirectory, int width, int height);
 
     int init();
     void resize(int width, int height);
@@ -105,7 +105,7 @@ AAssetManager* loadAssetManager(JNIEnv *env, jobject assetManager);
 #define JCT JNIEnv* env, jobject
 
 // FireActivity
-JC(void) Java_com_pbf_FireActivity_init(JNIEnv* env, jobject, jobject mgr, jint width, jint height);
+JC(void) Java_com_pbf_FireActivity_init(JNIEnv* env, jobject, jobject mgr, jstring cacheDirectory, jint width, jint height);
 // FireRenderer
 JC(jint) Java_com_pbf_FireRenderer_init(JCT);
 JC(void) Java_com_pbf_FireRenderer_resize(JCT, jint width, jint height);
@@ -8,6 +8,7 @@
 #include <math.h>
 #include <chrono>
 #include <string>
+#include <vector>
 
 #include <GLES3/gl31.h>
 #include <GLES3/gl3ext.h>
@@ -46,11 +47,9 @@ int RayRenderer::init(Settings* settings) {
 
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    back_FBO = nullptr;
     front_FBO = nullptr;
 
-    densityTexID = UINT32_MAX;
-    temperatureTexID = UINT32_MAX;
+    substanceTexID = UINT32_MAX;
 
     //glGetIntegerv(GL_MAX_COMPUTE_SHARED_MEMORY_SIZE, &threads);
 
@@ -58,6 +57,7 @@ int RayRenderer::init(Settings* settings) {
     initCube(VAO, VBO, EBO);
     initQuad(quad_VAO, quad_VBO, quad_EBO);
     initSSBO();
+    timer.init();
 
     if(!checkGLError("render initialization"))
     {
@@ -73,8 +73,20 @@ int RayRenderer::init(Settings* settings) {
     backgroundColor = settings->getBackgroundColor();
     filterColor = settings->getFilterColor();
     colorSpace = settings->getColorSpace();
+    rayStepSize = settings->getRayStepSize();
+    rayTransmittanceThreshold = settings->getRayTransmittanceThreshold();
+    temporalAccumulation = settings->getTemporalAccumulation();
+    tiledRayMarching = settings->getTiledRayMarching();
+    temperatureRange = settings->getRenderProxy() ? settings->getRenderProxyTemperatures() : vec2(0.0f, 1.0f);
+    dynamicResolution = settings->getDynamicResolution();
+    renderTargetTime = settings->getRenderTargetTime();
+    renderScaleBounds = settings->getRenderScaleBounds();
+    if(!dynamicResolution)
+        resolutionScale = 1.0f;
     touchMode = settings->getTouchMode();
 
+    updateEmissionTexture(settings->getSourceTemperature());
+
     //initDebug();
 
     return 1;
@@ -85,7 +97,21 @@ int RayRenderer::changeSettings(Settings* settings) {
     backgroundColor = settings->getBackgroundColor();
     filterColor = settings->getFilterColor();
     colorSpace = settings->getColorSpace();
+    rayStepSize = settings->getRayStepSize();
+    rayTransmittanceThreshold = settings->getRayTransmittanceThreshold();
+    if(temporalAccumulation != settings->getTemporalAccumulation())
+        historyValid = false;
+    temporalAccumulation = settings->getTemporalAccumulation();
+    tiledRayMarching = settings->getTiledRayMarching();
+    temperatureRange = settings->getRenderProxy() ? settings->getRenderProxyTemperatures() : vec2(0.0f, 1.0f);
+    dynamicResolution = settings->getDynamicResolution();
+    renderTargetTime = settings->getRenderTargetTime();
+    renderScaleBounds = settings->getRenderScaleBounds();
+    if(!dynamicResolution)
+        resolutionScale = 1.0f;
     touchMode = settings->getTouchMode();
+
+    updateEmissionTexture(settings->getSourceTemperature());
     return 1;
 }
 
@@ -96,7 +122,9 @@ void RayRenderer::initSSBO() {
 
     glGenBuffers(1, &ssbo);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, 65536, NULL, GL_DYNAMIC_READ);
+    // The adapted white point, which starts out unset
+    const vec4 unset = vec4(0.0f);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(vec4), &unset, GL_DYNAMIC_COPY);
     LOG_INFO("DONE INITING SSBO");
 }
 
@@ -106,7 +134,7 @@ Framebuffer *RayRenderer::updateFBO(Framebuffer *FBO, int window_width, int wind
         FBO->resize(window_width, window_height);
     } else {
         FBO = new Framebuffer();
-        FBO->create(window_width, window_height, GL_RGBA16F, GL_HALF_FLOAT);
+        FBO->create(window_width, window_height, GL_RGBA16F, GL_HALF_FLOAT, false);
     }
     return FBO;
 }
@@ -121,6 +149,301 @@ void RayRenderer::resizeMaxTexture() {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
     glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, 1, 1);
+
+    // No adaptation until the maximum has been computed
+    const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_FLOAT, white);
+}
+
+void RayRenderer::resizeMaxTilesTexture() {
+    ivec2 tiles = (ivec2(sim_width, sim_height) + MAX_TILE_SIZE - 1) / MAX_TILE_SIZE;
+    if(maxTilesTexID != 0 && tiles == maxTilesSize)
+        return;
+    glDeleteTextures(1, &maxTilesTexID);
+    maxTilesSize = tiles;
+
+    glGenTextures(1, &maxTilesTexID);
+    glBindTexture(GL_TEXTURE_2D, maxTilesTexID);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, tiles.x, tiles.y);
+}
+
+void RayRenderer::updateWhitePoint(GLuint image, float delta_time) {
+    resizeMaxTilesTexture();
+
+    // Maximum of each tile
+    maxCompShader.use();
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, image); // LMS
+    glBindImageTexture(0, maxTilesTexID, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+    glDispatchCompute(maxTilesSize.x, maxTilesSize.y, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    // Maximum of the tiles, which the white point is adapted towards
+    maxFinalCompShader.use();
+    maxFinalCompShader.uniform1f("adaptation", 1.0f - exp(-delta_time / WHITE_POINT_ADAPTATION_TIME));
+
+    glBindTexture(GL_TEXTURE_2D, maxTilesTexID);
+    glBindImageTexture(0, maxTexID, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ssbo);
+
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void RayRenderer::resizeAccumulatedTextures() {
+    ivec2 size = ivec2(sim_width, sim_height);
+    if(accumulatedTexIDs[0] != 0 && size == accumulatedSize)
+        return;
+    glDeleteTextures(2, accumulatedTexIDs);
+    accumulatedSize = size;
+    historyValid = false;
+
+    glGenTextures(2, accumulatedTexIDs);
+    for(GLuint texture : accumulatedTexIDs) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+
+        // The history is read where the fire was in the last frame, which is between pixels
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, size.x, size.y);
+    }
+}
+
+GLuint RayRenderer::accumulate(GLuint image, const mat4& mvp) {
+    resizeAccumulatedTextures();
+
+    GLuint history = accumulatedTexIDs[accumulatedIndex];
+    accumulatedIndex = 1 - accumulatedIndex;
+    GLuint accumulated = accumulatedTexIDs[accumulatedIndex];
+
+    temporalShader.use();
+    temporalShader.uniformMatrix4f("inverseMVP", inverse(mvp));
+    temporalShader.uniformMatrix4f("previousMVP", previousMVP);
+    temporalShader.uniform1i("historyValid", historyValid);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, image);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, history);
+    glBindImageTexture(0, accumulated, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+    glDispatchCompute((accumulatedSize.x + 7) / 8, (accumulatedSize.y + 7) / 8, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    previousMVP = mvp;
+    historyValid = true;
+    return accumulated;
+}
+
+void RayRenderer::resizeTiledImage() {
+    ivec2 size = ivec2(sim_width, sim_height);
+    if(tiledImageTexID != 0 && size == tiledImageSize)
+        return;
+    glDeleteTextures(1, &tiledImageTexID);
+    tiledImageSize = size;
+
+    glGenTextures(1, &tiledImageTexID);
+    glBindTexture(GL_TEXTURE_2D, tiledImageTexID);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, size.x, size.y);
+
+    if(tiledImageFBO.getFBO() == 0)
+        tiledImageFBO.init();
+    tiledImageFBO.bind();
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tiledImageTexID, 0);
+    tiledImageFBO.unbind();
+
+    ivec2 tiles = (size + RAY_TILE_SIZE - 1) / RAY_TILE_SIZE;
+    if(tileListBuffer != 0 && tiles == tileCount)
+        return;
+    tileCount = tiles;
+    GLsizeiptr count = tiles.x * tiles.y;
+
+    if(tileListBuffer == 0) {
+        glGenBuffers(1, &tileListBuffer);
+        glGenBuffers(1, &tileMarksBuffer);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, tileListBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (3 + count) * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+
+    // No tile has been listed in any frame yet, and frames are marked from 1
+    std::vector<GLuint> marks(count, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, tileMarksBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(GLuint), marks.data(), GL_DYNAMIC_COPY);
+}
+
+void RayRenderer::marchTiles(const mat4& mvp, float lod) {
+    resizeTiledImage();
+
+    // Tiles that are not listed show no fire
+    tiledImageFBO.bind();
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    tiledImageFBO.unbind();
+
+    // The list starts out empty, as a dispatch of no work groups
+    const GLuint empty[] = {0, 1, 1};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, tileListBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(empty), empty);
+
+    tileClassifyShader.use();
+    tileClassifyShader.uniformMatrix4f("mvp", mvp);
+    tileClassifyShader.uniform3f("brickSize", vec3(RENDER_BRICK_SIZE) / vec3(texture_width, texture_height, texture_depth));
+    tileClassifyShader.uniform2f("imageSize", vec2(tiledImageSize));
+    tileClassifyShader.uniform1i("mark", (int) frame + 1);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, brickMaxTexID);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, tileListBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, tileMarksBuffer);
+
+    ivec3 groups = (brickMaxSize + 3) / 4;
+    glDispatchCompute(groups.x, groups.y, groups.z);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    // One work group for each listed tile
+    rayMarchShader.use();
+    rayMarchShader.uniformMatrix4f("inverseMVP", inverse(mvp));
+    rayMarchShader.uniform1i("tilesX", tileCount.x);
+    loadRayMarching(rayMarchShader, lod);
+    glBindImageTexture(0, tiledImageTexID, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, tileListBuffer);
+    glDispatchComputeIndirect(0);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void RayRenderer::loadRayMarching(Shader& shader, float lod) {
+    // With temporal accumulation, the samples of each frame start at another part of the step, which is spread
+    // evenly over the frames that are blended together
+    shader.uniform1f("stepSize", temporalAccumulation ? rayStep() * TEMPORAL_STEP_SCALE : rayStep());
+    shader.uniform1f("frameJitter", temporalAccumulation ? (float) fmod(frame * 0.6180339887, 1.0) : 0.0f);
+    shader.uniform1f("transmittanceThreshold", rayTransmittanceThreshold);
+    shader.uniform1f("maxTemperature", emissionTemperature);
+    shader.uniform1f("lod", lod);
+    shader.uniform2f("temperatureRange", temperatureRange);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_3D, substanceTexID);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_3D, brickMaxTexID);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, emissionTexID);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_3D, substanceMipsTexID);
+}
+
+GLuint RayRenderer::createPairImageTexture(ivec3 size, int levels, GLint minFilter, GLint magFilter) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
+
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, magFilter);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    // RGBA since RG16F can't be written through an image
+    glTexStorage3D(GL_TEXTURE_3D, levels, GL_RGBA16F, size.x, size.y, size.z);
+    return texture;
+}
+
+void RayRenderer::resizeBrickMaxTexture(ivec3 size) {
+    ivec3 bricks = (size + RENDER_BRICK_SIZE - 1) / RENDER_BRICK_SIZE;
+    if(brickMaxTexID != 0 && bricks == brickMaxSize)
+        return;
+    glDeleteTextures(1, &brickMaxTexID);
+    brickMaxSize = bricks;
+    brickMaxTexID = createPairImageTexture(bricks, 1, GL_NEAREST, GL_NEAREST);
+}
+
+void RayRenderer::updateBrickMax(float lod) {
+    brickMaxShader.use();
+    // A sample is filtered from the neighbouring cells, or with a level of detail from the averaged texels around it,
+    // which are 2^ceil(lod) cells wide and reach one and a half texels from the sample
+    int apron = lod > 0.0f ? (int) ceil(1.5f * exp2(ceil(lod))) : 1;
+    brickMaxShader.uniform1i("apron", apron);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, substanceTexID);
+    glBindImageTexture(0, brickMaxTexID, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+    glDispatchCompute(brickMaxSize.x, brickMaxSize.y, brickMaxSize.z);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void RayRenderer::resizeSubstanceMips(ivec3 size) {
+    ivec3 half = max(size / 2, ivec3(1));
+    if(substanceMipsTexID != 0 && half == substanceMipsSize)
+        return;
+    glDeleteTextures(1, &substanceMipsTexID);
+    substanceMipsSize = half;
+
+    substanceMipLevels = 1;
+    while(substanceMipLevels < SUBSTANCE_MIP_LEVELS && all(greaterThan(half >> substanceMipLevels, ivec3(0))))
+        substanceMipLevels++;
+
+    substanceMipsTexID = createPairImageTexture(half, substanceMipLevels, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+}
+
+void RayRenderer::updateSubstanceMips(int levels) {
+    downsampleShader.use();
+    glActiveTexture(GL_TEXTURE0);
+
+    // The first level is averaged from the substance, and each level after that from the one before it
+    for(int level = 0; level < min(levels, substanceMipLevels); level++) {
+        glBindTexture(GL_TEXTURE_3D, level == 0 ? substanceTexID : substanceMipsTexID);
+        downsampleShader.uniform1i("sourceLevel", level == 0 ? 0 : level - 1);
+        glBindImageTexture(0, substanceMipsTexID, level, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+        ivec3 size = max(substanceMipsSize >> level, ivec3(1));
+        ivec3 groups = (size + 3) / 4;
+        glDispatchCompute(groups.x, groups.y, groups.z);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+}
+
+void RayRenderer::updateEmissionTexture(float maxTemperature) {
+    if(emissionTexID != 0 && maxTemperature == emissionTemperature)
+        return;
+    emissionTemperature = maxTemperature;
+
+    if(emissionTexID == 0) {
+        glGenTextures(1, &emissionTexID);
+        glBindTexture(GL_TEXTURE_2D, emissionTexID);
+
+        // Float textures can't be filtered, so the temperatures are interpolated in the shader
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        // The radiance is far outside the range of half floats
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, EMISSION_TABLE_SIZE, 1);
+    }
+
+    emissionShader.use();
+    emissionShader.uniform1f("maxTemperature", maxTemperature);
+    glBindImageTexture(0, emissionTexID, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+    glDispatchCompute((EMISSION_TABLE_SIZE + 63) / 64, 1, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
 }
 
 void RayRenderer::resize(int width, int height) {
@@ -135,14 +458,15 @@ void RayRenderer::resizeSim() {
 
     simScale();
 
-    back_FBO = updateFBO(back_FBO, sim_width, sim_height, GL_RGBA16F, GL_HALF_FLOAT);
-    front_FBO = updateFBO(front_FBO, sim_width, sim_height, GL_RGBA16F, GL_HALF_FLOAT);
+    // Only the image that the rays are marched into is kept up to date
+    if(!tiledRayMarching)
+        front_FBO = updateFBO(front_FBO, sim_width, sim_height, GL_RGBA16F, GL_HALF_FLOAT);
 
 }
 
 void RayRenderer::simScale() {
 
-    float scale = 1;
+    float scale = resolutionScale;
 
     int gcd = std::__algo_gcd(window_width, window_height);
     int w = window_width / gcd;
@@ -154,6 +478,8 @@ void RayRenderer::simScale() {
         n = (int) ceil(max_sim_res * scale / h);
     }
 
+    n = max(n, 1);
+
     sim_width = n * w;
     sim_height = n * h;
 
@@ -163,8 +489,7 @@ void RayRenderer::simScale() {
 
 void RayRenderer::initDebug() {
     debugSize = ivec3(100, 100, 100);
-    float* den = new float[debugSize.x*debugSize.y*debugSize.z];
-    float* temp = new float[debugSize.x*debugSize.y*debugSize.z];
+    vec2* substance = new vec2[debugSize.x*debugSize.y*debugSize.z];
     for (int z = 0; z < debugSize.z; ++z) {
         for (int y = 0; y < debugSize.y; ++y) {
             for (int x = 0; x < debugSize.x; ++x) {
@@ -172,23 +497,19 @@ void RayRenderer::initDebug() {
                 int Y = y - debugSize.y/2;
                 int Z = z - debugSize.z/2;
                 if(sqrt(X*X+Y*Y+Z*Z) < 8) {
-                    den[z * debugSize.y * debugSize.x + y * debugSize.x + x] = 1.0f;
-                    temp[z * debugSize.y * debugSize.x + y * debugSize.x + x] = 3500.0f;
+                    substance[z * debugSize.y * debugSize.x + y * debugSize.x + x] = vec2(1.0f, 3500.0f);
                 }
             }
         }
     }
-    createScalar3DTexture(debugDens,debugSize,den);
-    createScalar3DTexture(debugTemp,debugSize,temp);
+    createPair3DTexture(debugSubstance,debugSize,substance);
 
-    delete[] den;
-    delete[] temp;
+    delete[] substance;
 }
 
-void RayRenderer::setData(GLuint density, GLuint temperature, ivec3 size) {
+void RayRenderer::setData(GLuint substance, ivec3 size) {
 
-    densityTexID = density;
-    temperatureTexID = temperature;
+    substanceTexID = substance;
 
     texture_width = size.x;
     texture_height = size.y;
@@ -294,85 +615,122 @@ void RayRenderer::initCube(GLuint &VAO, GLuint &VBO, GLuint &EBO) {
 
 int RayRenderer::initProgram() {
     bool success = true;
-    success &= frontFaceShader.load("shaders/render/ray.vert", "shaders/render/front_face.frag");
-    success &= backFaceShader.load("shaders/render/ray.vert", "shaders/render/back_face.frag");
+    // The white point is only adapted to the maximum once its compute shaders are ready
+    success &= maxCompShader.loadAsync("shaders/render/max.comp");
+    success &= maxFinalCompShader.loadAsync("shaders/render/max_final.comp");
+    success &= brickMaxShader.load("shaders/render/brick_max.comp", {{"BRICK_SIZE", std::to_string(RENDER_BRICK_SIZE)}});
+    success &= emissionShader.load("shaders/render/emission.comp",
+                                   {{"LAMBDA_SAMPLES", std::to_string(EMISSION_LAMBDA_SAMPLES)}});
+    success &= frontFaceShader.load("shaders/render/ray.vert", "shaders/render/front_face.frag",
+                                    {{"EMPTY_DENSITY", std::to_string(RENDER_EMPTY_DENSITY)}});
+    success &= tileClassifyShader.load("shaders/render/tile_classify.comp",
+                                       {{"TILE_SIZE", std::to_string(RAY_TILE_SIZE)},
+                                        {"EMPTY_DENSITY", std::to_string(RENDER_EMPTY_DENSITY)}});
+    success &= rayMarchShader.load("shaders/render/ray_march.comp",
+                                   {{"TILE_SIZE", std::to_string(RAY_TILE_SIZE)},
+                                    {"EMPTY_DENSITY", std::to_string(RENDER_EMPTY_DENSITY)}});
+    success &= temporalShader.load("shaders/render/temporal.comp");
+    success &= downsampleShader.load("shaders/render/downsample.comp");
     success &= quadShader.load("shaders/render/vertex.vert", "shaders/render/quad.frag");
-    success &= maxCompShader.load("shaders/render/max.comp");
     return success;
 }
 
-void RayRenderer::step(GLuint density, GLuint temperature, ivec3 size) {
+void RayRenderer::updateResolutionScale() {
+    float time;
+    if(!dynamicResolution || !timer.poll(time))
+        return;
 
-    setData(density, temperature, size);
+    // The time grows with the number of pixels, so each side is scaled by the square root of the ratio to the target.
+    // Small differences are ignored, and large ones are limited, so that the resolution doesn't change back and forth
+    float ratio = sqrt(renderTargetTime / time);
+    if(abs(ratio - 1.0f) < 0.05f)
+        return;
+    resolutionScale = clamp(resolutionScale * clamp(ratio, 0.9f, 1.1f), renderScaleBounds.x, renderScaleBounds.y);
+}
 
-    float current_time = DURATION(NOW, start_time);
-    float delta_time = DURATION(NOW, last_time);
-    last_time = NOW;
+void RayRenderer::step(GLuint substance, ivec3 size) {
 
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
+    updateResolutionScale();
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    setData(substance, size);
+
+    timer.begin();
+    draw();
+    timer.end();
+}
 
-    glViewport(0, 0, sim_width, sim_height);
+void RayRenderer::draw() {
 
-    glBindVertexArray(VAO);
+    // The averaged levels are only needed when a cell is smaller than a pixel
+    resizeSubstanceMips(ivec3(texture_width, texture_height, texture_depth));
+    float lod = substanceLod();
+    if(lod > 0.0f)
+        updateSubstanceMips((int) ceil(lod));
+
+    resizeBrickMaxTexture(ivec3(texture_width, texture_height, texture_depth));
+    updateBrickMax(lod);
+
+    float current_time = DURATION(NOW, start_time);
+    float delta_time = DURATION(NOW, last_time);
+    last_time = NOW;
 
     clearGLErrors("rendering");
-    // back
-    if(!back_FBO->bind("back rendering"))
-        return;
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glCullFace(GL_BACK);
 
-    backFaceShader.use();
-    loadMVP(backFaceShader, current_time);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    GLuint image;
+    if(tiledRayMarching) {
+        marchTiles(getMVP(), lod);
 
-    if(!checkGLError("back rendering"))
-        return;
+        if(!checkGLError("tiled ray marching"))
+            return;
+        image = tiledImageTexID;
+    } else {
+        // The faces of the box where the rays enter don't overlap, so they are drawn without a depth test
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
 
-    // front
-    if(!front_FBO->bind("front rendering"))
-        return;
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glCullFace(GL_FRONT);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    frontFaceShader.use();
-    loadMVP(frontFaceShader, current_time);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, back_FBO->texture());
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_3D, densityTexID);
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_3D, temperatureTexID);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+        glViewport(0, 0, sim_width, sim_height);
 
-    if(!checkGLError("front rendering"))
-        return;
+        glBindVertexArray(VAO);
 
-    maxCompShader.use();
+        // front
+        if(!front_FBO->bind("front rendering"))
+            return;
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glCullFace(GL_FRONT);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, front_FBO->texture()); // LMS
+        frontFaceShader.use();
+        loadMVP(frontFaceShader, current_time);
+        // The rays leave the box where they reach its bounds, which is found from the position of the camera in the box
+        frontFaceShader.uniform3f("cameraPosition", vec3(inverse(getModelMatrix()) * vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+        loadRayMarching(frontFaceShader, lod);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
 
-    glBindImageTexture(0, maxTexID, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        if(!checkGLError("front rendering"))
+            return;
 
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, ssbo);
+        front_FBO->unbind();
+        image = front_FBO->texture();
+    }
 
-    glUniform2i(glGetUniformLocation(maxCompShader.program(), "size"), sim_width, sim_height);
+    if(temporalAccumulation) {
+        image = accumulate(image, getMVP());
 
-    glDispatchCompute(1, 1, 1);
-    glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
-    glMemoryBarrier(GL_ALL_SHADER_BITS);
+        if(!checkGLError("temporal accumulation"))
+            return;
+    }
+    frame++;
 
-    if(!checkGLError("max compute"))
-        return;
+    if(maxCompShader.isReady() && maxCompShader.program() != 0
+       && maxFinalCompShader.isReady() && maxFinalCompShader.program() != 0) {
+        updateWhitePoint(image, delta_time);
 
-    front_FBO->unbind();
+        if(!checkGLError("max compute"))
+            return;
+    }
 
     // quad
     glBindVertexArray(quad_VAO);
@@ -381,13 +739,17 @@ void RayRenderer::step(GLuint density, GLuint temperature, ivec3 size) {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glDisable(GL_CULL_FACE);
 
+    // The image is blended over the background by its alpha
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
     quadShader.use();
 
     quadShader.uniform3f("filterColor", filterColor);
     quadShader.uniform3f("colorSpace", colorSpace);
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, front_FBO->texture());
+    glBindTexture(GL_TEXTURE_2D, image);
     glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_2D, maxTexID); //todo
 
@@ -413,7 +775,25 @@ void RayRenderer::scale(float scaleFactor, double scaleX, double scaleY){
         zoom *= scaleFactor;
 }
 
-void RayRenderer::loadMVP(Shader shader, float current_time) {
+void RayRenderer::loadMVP(Shader& shader, float current_time) {
+
+    shader.uniformMatrix4f("mvp", getMVP());
+    shader.bindUniformBlocks();
+
+}
+
+mat4 RayRenderer::getModelMatrix() {
+
+    vec3 modelPos(0, 0.0f, -1.0);
+
+    return translate(mat4(1.0f), modelPos+vec3(0.0f, -ry, 0.0f))
+           * rotate(mat4(1.0f), (float) rx, vec3(0, 1, 0))
+           //* rotate(mat4(1.0f), (float)ry, vec3(1,0,0))
+           * glm::scale(mat4(1.0f), boundingScale)
+           * translate(mat4(1.0f), vec3(-0.5f, -0.5f, -0.5f));
+}
+
+mat4 RayRenderer::getMVP() {
 
     // Set up a projection matrix
     float nearPlane = 0.01f;
@@ -423,19 +803,28 @@ void RayRenderer::loadMVP(Shader shader, float current_time) {
 
     vec3 modelPos(0, 0.0f, -1.0);
 
-    mat4 modelMatrix = translate(mat4(1.0f), modelPos+vec3(0.0f, -ry, 0.0f))
-                       * rotate(mat4(1.0f), (float) rx, vec3(0, 1, 0))
-                       //* rotate(mat4(1.0f), (float)ry, vec3(1,0,0))
-                       * glm::scale(mat4(1.0f), boundingScale)
-                       * translate(mat4(1.0f), vec3(-0.5f, -0.5f, -0.5f));
+    mat4 modelMatrix = getModelMatrix();
 
     mat4 viewMatrix = lookAt(vec3(0), modelPos, worldUp);
     mat4 projectionMatrix = perspective(fovy/zoom, aspectRatio, nearPlane, farPlane);
 
-    mat4 mvp = projectionMatrix * viewMatrix * modelMatrix;
+    return projectionMatrix * viewMatrix * modelMatrix;
+}
+
+float RayRenderer::cellsPerPixel() {
+    float fovy = radians(60.0f);
+    float distance = length(vec3(0.0f, -ry, -1.0f));
 
-    glUniformMatrix4fv(glGetUniformLocation(shader.program(), "mvp"), 1, GL_FALSE, &mvp[0].x);
+    float pixelSize = 2.0f * tan(fovy / (2.0f * zoom)) * distance / sim_height;
+    return pixelSize * max_sim_res;
+}
 
+float RayRenderer::rayStep() {
+    return rayStepSize * max(cellsPerPixel(), 1.0f);
+}
+
+float RayRenderer::substanceLod() {
+    return clamp(log2(cellsPerPixel()), 0.0f, (float) substanceMipLevels);
 }
 
 #pragma clang diagnostic pop
@@ -453,25 +842,5 @@ float RayRenderer::getRotation(){
 }
 
 mat4 RayRenderer::getInverseMVP(){
-    // Set up a projection matrix
-    float nearPlane = 0.01f;
-    float farPlane = 100.0f;
-    float fovy = radians(60.0f);
-    float aspectRatio = (float) window_width / window_height;
-
-    vec3 modelPos(0, 0.0f, -1.0);
-
-    mat4 modelMatrix = translate(mat4(1.0f), modelPos+vec3(0.0f, -ry, 0.0f))
-                       * rotate(mat4(1.0f), (float) rx, vec3(0, 1, 0))
-                       //* rotate(mat4(1.0f), (float)ry, vec3(1,0,0))
-                       * glm::scale(mat4(1.0f), boundingScale)
-                       * translate(mat4(1.0f), vec3(-0.5f, -0.5f, -0.5f));
-
-    mat4 viewMatrix = lookAt(vec3(0), modelPos, worldUp);
-    mat4 projectionMatrix = perspective(fovy/zoom, aspectRatio, nearPlane, farPlane);
-
-    mat4 mvp = projectionMatrix * viewMatrix * modelMatrix;
-
-    return inverse(mvp);
+    return inverse(getMVP());
 }
-
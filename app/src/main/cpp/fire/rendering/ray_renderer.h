@@ -15,9 +15,32 @@
 
 #include "fire/util/shader.h"
 #include "fire/util/framebuffer.h"
+#include "fire/util/gpu_timer.h"
 
 using namespace glm;
 
+// Size of the bricks along each axis, in cells of the substance, that the ray marching leaps over when empty
+#define RENDER_BRICK_SIZE 8
+// Bricks where the density is at most this much have no visible fire
+#define RENDER_EMPTY_DENSITY 0.001f
+// Side of the tiles that rays are marched in when the ray marching is tiled, in pixels
+#define RAY_TILE_SIZE 8
+
+// Largest number of levels of the averaged substance, which starts at half of its size
+#define SUBSTANCE_MIP_LEVELS 4
+
+// Number of temperatures in the emission table, and of wavelengths that each of them is integrated over
+#define EMISSION_TABLE_SIZE 1024
+#define EMISSION_LAMBDA_SAMPLES 5
+
+// Side of the tiles that the first pass of the white point maximum reduces, in pixels
+#define MAX_TILE_SIZE 32
+// How many times longer the ray marching steps are when the images are accumulated over time
+#define TEMPORAL_STEP_SCALE 2.0f
+
+// Time in seconds for the white point to move most of the way (1 - 1/e) to a new maximum
+#define WHITE_POINT_ADAPTATION_TIME 0.25f
+
 using std::chrono::time_point;
 using std::chrono::system_clock;
 
@@ -31,10 +54,33 @@ class RayRenderer {
     vec3 backgroundColor, filterColor;
     vec3 colorSpace;
 
+    // The temperatures that the temperature channel of the substance maps 0 and 1 to
+    vec2 temperatureRange;
+
+    // Length of the ray marching steps in cells when a cell covers a pixel, and the transmittance where rays stop
+    float rayStepSize, rayTransmittanceThreshold;
+
+    // Scale of the ray marching resolution, which follows the time that the ray marching takes on the GPU when the
+    // resolution is dynamic, see Settings::withDynamicResolution
+    float resolutionScale = 1.0f;
+    bool dynamicResolution;
+    float renderTargetTime;
+    vec2 renderScaleBounds;
+    GpuTimer timer;
+
     // Framebuffers
-    Framebuffer *back_FBO;
     Framebuffer *front_FBO;
 
+    // Whether rays are only marched in the listed tiles of the image, see Settings::withTiledRayMarching
+    bool tiledRayMarching;
+    // The tiles to march, after the arguments of their dispatch, and the mark of the frame each tile was last listed in
+    GLuint tileListBuffer = 0, tileMarksBuffer = 0;
+    ivec2 tileCount;
+    // Image that the rays of the listed tiles are marched into, and a framebuffer that clears the rest of it
+    GLuint tiledImageTexID = 0;
+    ivec2 tiledImageSize;
+    SimpleFramebuffer tiledImageFBO;
+
     GLuint ssbo;
 
     // Cube Buffers
@@ -46,18 +92,42 @@ class RayRenderer {
     GLuint quad_VAO;      // Vertex Array Object
     GLuint quad_VBO, quad_EBO; // Vertex Buffer Object && Element Buffer Object
 
-    // 3D texture
-    GLuint temperatureTexID;
-    GLuint densityTexID;
+    // 3D texture with the density and temperature in its first and second channel
+    GLuint substanceTexID;
+
+    // 3D texture with the maximum density and temperature of each brick of the substance
+    GLuint brickMaxTexID = 0;
+    ivec3 brickMaxSize;
+
+    // 3D texture with the substance averaged over 2, 4, 8.. cells in each level, for when cells are smaller than pixels
+    GLuint substanceMipsTexID = 0;
+    ivec3 substanceMipsSize;
+    int substanceMipLevels;
+
+    // Table of the radiance in XYZ that is emitted at each temperature, up to emissionTemperature
+    GLuint emissionTexID = 0;
+    float emissionTemperature;
 
     // debug 3D texture
-    GLuint debugTemp;
-    GLuint debugDens;
+    GLuint debugSubstance;
     ivec3 debugSize;
 
     // texture
     GLuint maxTexID;
 
+    // The image accumulated over time, which alternates between the two textures so that the last one can be read
+    bool temporalAccumulation;
+    GLuint accumulatedTexIDs[2] = {0, 0};
+    ivec2 accumulatedSize;
+    int accumulatedIndex = 0;
+    bool historyValid = false;
+    mat4 previousMVP;
+    unsigned int frame = 0;
+
+    // Maximum of each tile of the rendered image
+    GLuint maxTilesTexID = 0;
+    ivec2 maxTilesSize;
+
     // rotation
     double rx = 0.0f;
     double ry = 0.0f;
@@ -69,7 +139,8 @@ class RayRenderer {
     float zoom  = 1.0f;
 
     // Shaders
-    Shader frontFaceShader, backFaceShader, quadShader, maxCompShader;
+    Shader frontFaceShader, quadShader, maxCompShader, maxFinalCompShader, brickMaxShader, emissionShader, temporalShader, downsampleShader;
+    Shader tileClassifyShader, rayMarchShader;
 
     // Time
     time_point<system_clock> start_time, last_time;
@@ -84,7 +155,7 @@ public:
 
     void resize(int width, int height);
 
-    void step(GLuint density, GLuint temperature, ivec3 size);
+    void step(GLuint substance, ivec3 size);
 
     void touch(double dx, double dy);
 
@@ -106,19 +177,78 @@ private:
                            GLuint type);
     void resizeMaxTexture();
 
+    // Recreates the texture of the tile maximums if it doesn't fit the rendered image
+    void resizeMaxTilesTexture();
+
+    // Reduces the rendered image to its maximum, and adapts the white point towards it
+    void updateWhitePoint(GLuint image, float delta_time);
+
+    // Recreates the textures of the accumulated image if they don't fit the rendered image
+    void resizeAccumulatedTextures();
+
+    // Blends the given image rendered this frame into the accumulated image, and returns the texture of the result
+    GLuint accumulate(GLuint image, const mat4& mvp);
+
+    // Recreates the tiled image and the buffers of its tiles if they don't fit the rendered image
+    void resizeTiledImage();
+
+    // Lists the tiles that bricks with density cover, and marches the rays of those tiles into the tiled image
+    void marchTiles(const mat4& mvp, float lod);
+
+    // Sets the uniforms and textures that the ray marching of the shader reads
+    void loadRayMarching(Shader& shader, float lod);
+
+    // Creates a clamped 3D texture with the given mip levels and filters, for pairs that are written through images
+    GLuint createPairImageTexture(ivec3 size, int levels, GLint minFilter, GLint magFilter);
+
+    // Recreates the brick maximum texture if it doesn't fit a substance of the given size
+    void resizeBrickMaxTexture(ivec3 size);
+
+    // Computes the maximum density and temperature of each brick of the substance, including the cells around it that
+    // samples within it are filtered from at the given level of detail
+    void updateBrickMax(float lod);
+
+    // Recreates the averaged substance texture if it doesn't fit a substance of the given size
+    void resizeSubstanceMips(ivec3 size);
+
+    // Averages the substance into the levels of the averaged substance texture, down to the given number of levels
+    void updateSubstanceMips(int levels);
+
+    // Computes the emission table for temperatures up to the given one, unless it already has been
+    void updateEmissionTexture(float maxTemperature);
+
     void initCube(GLuint &VAO, GLuint &VBO, GLuint &EBO);
 
     void initQuad(GLuint &VAO, GLuint &VBO, GLuint &EBO);
 
     int initProgram();
 
-    void setData(GLuint density, GLuint temperature, ivec3 size);
+    void setData(GLuint substance, ivec3 size);
+
+    // Moves the resolution scale towards the target time, if a new time has been measured
+    void updateResolutionScale();
+
+    // Renders the substance that was set
+    void draw();
 
     void simScale();
 
     void resizeSim();
 
-    void loadMVP(Shader shader, float current_time);
+    void loadMVP(Shader& shader, float current_time);
+
+    mat4 getModelMatrix();
+
+    mat4 getMVP();
+
+    // Returns the width of a pixel in cells of the substance, at the distance of the model
+    float cellsPerPixel();
+
+    // Returns the length of the ray marching steps in cells, which are longer when a cell is smaller than a pixel
+    float rayStep();
+
+    // Returns the level of detail that the substance is sampled at, where 1 is the first averaged level
+    float substanceLod();
 
 };
 
@@ -39,8 +39,8 @@ void Renderer::resize(int width, int height){
     rayRenderer->resize(width, height);
 }
 
-void Renderer::update(GLuint density, GLuint temperature, ivec3 size) {
-    rayRenderer->step(density, temperature, size);
+void Renderer::update(GLuint substance, ivec3 size) {
+    rayRenderer->step(substance, size);
 }
 
 void Renderer::scale(float scaleFactor, double scaleX, double scaleY){
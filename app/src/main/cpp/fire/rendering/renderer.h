@@ -23,7 +23,7 @@ public:
     int changeSettings(Settings* settings);
 
     void resize(int width, int height);
-    void update(GLuint density, GLuint temperature, ivec3 size);
+    void update(GLuint substance, ivec3 size);
 
     void scale(float scaleFactor, double scaleX, double scaleY);
     void touch(double dx, double dy);
@@ -35,8 +35,26 @@ Settings::Settings() {
     backgroundColor = vec3(0.0f, 0.0f, 0.0f);
     filterColor = vec3(1.0f, 1.0f, 1.0f);
     colorSpace = vec3(1.0f, 1.0f, 1.0f);
+    rayStepSize = 1.0f;
+    rayTransmittanceThreshold = 0.01f;
+    temporalAccumulation = false;
+    dynamicResolution = false;
+    renderTargetTime = 0.0f;
+    renderScaleBounds = vec2(1.0f, 1.0f);
+    renderProxy = false;
+    renderProxyTemperatures = vec2(0.0f, 1.0f);
+    tiledRayMarching = true;
 
     boundaryType = BoundaryType::some;
+    slabBackend = SlabBackend::fragment;
+    velocityLayout = FieldLayout::volume;
+    substanceLayout = FieldLayout::volume;
+    vectorPrecision = Precision::half;
+    scalarPrecision = Precision::half;
+    pressurePrecision = Precision::full;
+    operatorFusion = false;
+    activeBricks = false;
+    activeBrickThresholds = vec3(0.0f);
     sourceMode = SourceMode::add;
     sourceType = SourceType::singleSphere;
     sourceRadius = 0.0f;
@@ -47,6 +65,12 @@ Settings::Settings() {
     orientationVector = vec3(0.0f, 1.0f, 0.0f);
 
     projectionIterations = 0;
+    pressureSolver = PressureSolver::iterative;
+    pressureTolerance = 0.0f;
+    relaxation = Relaxation::jacobi;
+    overRelaxation = 1.0f;
+    velocityAdvection = AdvectionScheme::semiLagrangian;
+    substanceAdvection = AdvectionScheme::semiLagrangian;
     vorticityScale = 0.0f;
     velocityKinematicViscosity = 0.0f;
     velocityDiffusionIterations = 0;
@@ -89,7 +113,20 @@ void Settings::printInfo(std::string header) {
     LOG_INFO("backgroundColor: %f, %f, %f", backgroundColor.x, backgroundColor.y, backgroundColor.z);
     LOG_INFO("filterColor: %f, %f, %f", filterColor.x, filterColor.y, filterColor.z);
     LOG_INFO("colorSpace: %f, %f, %f", colorSpace.x, colorSpace.y, colorSpace.z);
+    LOG_INFO("rayMarching: %f, %f", rayStepSize, rayTransmittanceThreshold);
+    LOG_INFO("temporalAccumulation: %s", temporalAccumulation ? "true" : "false");
+    LOG_INFO("dynamicResolution: %s, %f, %f, %f", dynamicResolution ? "true" : "false", renderTargetTime,
+            renderScaleBounds.x, renderScaleBounds.y);
+    LOG_INFO("renderProxy: %s, %f, %f", renderProxy ? "true" : "false", renderProxyTemperatures.x,
+            renderProxyTemperatures.y);
+    LOG_INFO("tiledRayMarching: %s", tiledRayMarching ? "true" : "false");
     LOG_INFO("boundaryType: %d", (int)boundaryType);
+    LOG_INFO("slabBackend: %d", (int)slabBackend);
+    LOG_INFO("fieldLayout: %d, %d", (int)velocityLayout, (int)substanceLayout);
+    LOG_INFO("fieldPrecision: %d, %d, %d", (int)vectorPrecision, (int)scalarPrecision, (int)pressurePrecision);
+    LOG_INFO("operatorFusion: %s", operatorFusion ? "true" : "false");
+    LOG_INFO("activeBricks: %s, %f, %f, %f", activeBricks ? "true" : "false",
+            activeBrickThresholds.x, activeBrickThresholds.y, activeBrickThresholds.z);
     LOG_INFO("sourceMode: %d", (int)sourceMode);
     LOG_INFO("sourceType: %d", (int)sourceType);
     LOG_INFO("sourceRadius: %f", sourceRadius);
@@ -98,6 +135,10 @@ void Settings::printInfo(std::string header) {
     LOG_INFO("sourceVelocity: %f, %f, %f", sourceVelocity.x, sourceVelocity.y, sourceVelocity.z);
     LOG_INFO("orientationVector: %f, %f, %f", orientationVector.x, orientationVector.y, orientationVector.z);
     LOG_INFO("projectionIterations: %d", projectionIterations);
+    LOG_INFO("pressureSolver: %d", (int)pressureSolver);
+    LOG_INFO("pressureTolerance: %f", pressureTolerance);
+    LOG_INFO("relaxation: %d, %f", (int)relaxation, overRelaxation);
+    LOG_INFO("advectionScheme: %d, %d", (int)velocityAdvection, (int)substanceAdvection);
     LOG_INFO("vorticityScale: %f", vorticityScale);
     LOG_INFO("velocityKinematicViscosity: %f", velocityKinematicViscosity);
     LOG_INFO("velocityDiffusionIterations: %d", velocityDiffusionIterations);
@@ -258,6 +299,53 @@ Settings* Settings::withProjectIterations(int projectionIterations) {
     return this;
 }
 
+PressureSolver Settings::getPressureSolver(){
+    return pressureSolver;
+}
+
+Settings* Settings::withPressureSolver(PressureSolver pressureSolver){
+    this->pressureSolver = pressureSolver;
+    return this;
+}
+
+float Settings::getPressureTolerance(){
+    return pressureTolerance;
+}
+
+Settings* Settings::withPressureTolerance(float pressureTolerance){
+    this->pressureTolerance = pressureTolerance;
+    return this;
+}
+
+Relaxation Settings::getRelaxation(){
+    return relaxation;
+}
+
+float Settings::getOverRelaxation(){
+    return overRelaxation;
+}
+
+Settings* Settings::withRelaxation(Relaxation relaxation, float overRelaxation){
+    this->relaxation = relaxation;
+    this->overRelaxation = overRelaxation;
+    return this;
+}
+
+AdvectionScheme Settings::getAdvectionScheme(Resolution res){
+    switch(res) {
+        case Resolution::velocity: return velocityAdvection;
+        case Resolution::substance: return substanceAdvection;
+    }
+}
+
+Settings* Settings::withAdvectionScheme(Resolution res, AdvectionScheme scheme){
+    switch(res) {
+        case Resolution::velocity: velocityAdvection = scheme; break;
+        case Resolution::substance: substanceAdvection = scheme; break;
+    }
+    return this;
+}
+
 float Settings::getBuoyancyScale() {
     return buoyancyScale;
 }
@@ -340,6 +428,71 @@ Settings* Settings::withColorSpace(vec3 colorSpace) {
     return this;
 }
 
+float Settings::getRayStepSize(){
+    return rayStepSize;
+}
+
+float Settings::getRayTransmittanceThreshold(){
+    return rayTransmittanceThreshold;
+}
+
+Settings* Settings::withRayMarching(float stepSize, float transmittanceThreshold){
+    this->rayStepSize = stepSize;
+    this->rayTransmittanceThreshold = transmittanceThreshold;
+    return this;
+}
+
+bool Settings::getTemporalAccumulation(){
+    return temporalAccumulation;
+}
+
+Settings* Settings::withTemporalAccumulation(bool temporalAccumulation){
+    this->temporalAccumulation = temporalAccumulation;
+    return this;
+}
+
+bool Settings::getDynamicResolution(){
+    return dynamicResolution;
+}
+
+float Settings::getRenderTargetTime(){
+    return renderTargetTime;
+}
+
+vec2 Settings::getRenderScaleBounds(){
+    return renderScaleBounds;
+}
+
+Settings* Settings::withDynamicResolution(bool dynamicResolution, float targetTime, float minScale, float maxScale){
+    this->dynamicResolution = dynamicResolution;
+    this->renderTargetTime = targetTime;
+    this->renderScaleBounds = vec2(minScale, maxScale);
+    return this;
+}
+
+bool Settings::getRenderProxy(){
+    return renderProxy;
+}
+
+vec2 Settings::getRenderProxyTemperatures(){
+    return renderProxyTemperatures;
+}
+
+Settings* Settings::withRenderProxy(bool renderProxy, float minTemperature, float maxTemperature){
+    this->renderProxy = renderProxy;
+    this->renderProxyTemperatures = vec2(minTemperature, maxTemperature);
+    return this;
+}
+
+bool Settings::getTiledRayMarching(){
+    return tiledRayMarching;
+}
+
+Settings* Settings::withTiledRayMarching(bool tiledRayMarching){
+    this->tiledRayMarching = tiledRayMarching;
+    return this;
+}
+
 bool Settings::getTouchMode(){
     return touchMode;
 }
@@ -442,3 +595,68 @@ Settings* Settings::withBoundaryType(BoundaryType boundaryType){
     this->boundaryType = boundaryType;
     return this;
 }
+
+SlabBackend Settings::getSlabBackend(){
+    return slabBackend;
+}
+
+Settings* Settings::withSlabBackend(SlabBackend slabBackend){
+    this->slabBackend = slabBackend;
+    return this;
+}
+
+FieldLayout Settings::getFieldLayout(Resolution res){
+    switch(res) {
+        case Resolution::velocity: return velocityLayout;
+        case Resolution::substance: return substanceLayout;
+    }
+}
+
+Settings* Settings::withFieldLayout(Resolution res, FieldLayout layout){
+    switch(res) {
+        case Resolution::velocity: velocityLayout = layout; break;
+        case Resolution::substance: substanceLayout = layout; break;
+    }
+    return this;
+}
+
+Precision Settings::getFieldPrecision(FieldKind kind){
+    switch(kind) {
+        case FieldKind::vectors: return vectorPrecision;
+        case FieldKind::scalars: return scalarPrecision;
+        case FieldKind::pressure: return pressurePrecision;
+    }
+}
+
+Settings* Settings::withFieldPrecision(FieldKind kind, Precision precision){
+    switch(kind) {
+        case FieldKind::vectors: vectorPrecision = precision; break;
+        case FieldKind::scalars: scalarPrecision = precision; break;
+        case FieldKind::pressure: pressurePrecision = precision; break;
+    }
+    return this;
+}
+
+bool Settings::getOperatorFusion(){
+    return operatorFusion;
+}
+
+Settings* Settings::withOperatorFusion(bool operatorFusion){
+    this->operatorFusion = operatorFusion;
+    return this;
+}
+
+bool Settings::getActiveBricks(){
+    return activeBricks;
+}
+
+vec3 Settings::getActiveBrickThresholds(){
+    return activeBrickThresholds;
+}
+
+Settings* Settings::withActiveBricks(bool activeBricks, float densityThreshold, float temperatureThreshold,
+        float speedThreshold){
+    this->activeBricks = activeBricks;
+    this->activeBrickThresholds = vec3(densityThreshold, temperatureThreshold, speedThreshold);
+    return this;
+}
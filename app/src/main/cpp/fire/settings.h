@@ -26,6 +26,50 @@ enum class SourceType {singleSphere, dualSpheres, floor, cube, pyramid, cylinder
 
 enum class BoundaryType {none, some};
 
+// How slab operations are executed on the GPU
+// fragment draws every depth layer of a field separately into a framebuffer
+// compute runs each operation as a single compute shader dispatch writing to an image3D
+enum class SlabBackend {fragment, compute};
+
+// How the fields of a resolution are stored
+// volume stores a field as a 3D texture
+// flat stores a field as a 2D texture with the z-slices laid out as tiles, so that an operation is a single draw
+enum class FieldLayout {volume, flat};
+
+// The kinds of fields that can be stored with different precision
+// vectors are the velocity and the other vector fields
+// scalars are the substance (the density and temperature stored together) and the other scalar fields
+// pressure is the pressure and divergence of projection, including the multigrid levels
+enum class FieldKind {vectors, scalars, pressure};
+
+// How each channel of a field is stored. Vector fields have a fourth channel, so that every format is renderable
+// unorm8 stores values between 0 and 1 in 8 bits, which only suits fields that are rendered and not simulated,
+// and not the substance since the temperature is much larger
+// half stores 16 bit floats
+// full stores 32 bit floats, which can't be filtered without OES_texture_float_linear
+// The compute backend writes fields through images, which always stores scalars as full and vectors as half, except
+// for unorm8 fields, which it renders to like the fragment backend
+enum class Precision {unorm8, half, full};
+
+// How the pressure equation is solved during projection
+// iterative runs iterations of the relaxation method on the velocity resolution
+// multigrid runs V-cycles over a hierarchy of coarser resolutions, which removes large scale divergence much faster
+enum class PressureSolver {iterative, multigrid};
+
+// How iterations of diffusion and projection update the solution
+// jacobi updates every cell from the values of the previous iteration
+// redBlack updates the cells of a checkerboard in two halves, where the second half uses the values of the first
+// (red-black gauss-seidel), and steps past the new value by the over-relaxation factor (SOR).
+// It converges faster per iteration, and with the compute backend it updates scalar fields in place
+enum class Relaxation {jacobi, redBlack};
+
+// How fields are moved along the velocity during advection
+// semiLagrangian interpolates each cell from the position that it is traced back to, which smooths out the field
+// macCormack also traces the result forward again, and corrects it by half of the difference from the original field.
+// The correction is limited to the values that were interpolated from, so it can't overshoot. It keeps detail that
+// would need a higher resolution with semiLagrangian, for about twice the cost of advection
+enum class AdvectionScheme {semiLagrangian, macCormack};
+
 class Settings {
     std::string name;
 
@@ -44,8 +88,23 @@ class Settings {
     bool orientationMode;
     vec3 backgroundColor, filterColor;
     vec3 colorSpace;
+    float rayStepSize;
+    float rayTransmittanceThreshold;
+    bool temporalAccumulation;
+    bool dynamicResolution;
+    float renderTargetTime;
+    vec2 renderScaleBounds;
+    bool renderProxy;
+    vec2 renderProxyTemperatures;
+    bool tiledRayMarching;
 
     BoundaryType boundaryType;
+    SlabBackend slabBackend;
+    FieldLayout velocityLayout, substanceLayout;
+    Precision vectorPrecision, scalarPrecision, pressurePrecision;
+    bool operatorFusion;
+    bool activeBricks;
+    vec3 activeBrickThresholds;
     SourceMode sourceMode;
     SourceType sourceType;
     float sourceRadius;
@@ -56,6 +115,11 @@ class Settings {
     vec3 orientationVector;
 
     int projectionIterations;
+    PressureSolver pressureSolver;
+    float pressureTolerance;
+    Relaxation relaxation;
+    float overRelaxation;
+    AdvectionScheme velocityAdvection, substanceAdvection;
     float vorticityScale;
     float velocityKinematicViscosity;
     int velocityDiffusionIterations;
@@ -157,6 +221,35 @@ public:
     // If the number of iterations is 0, the projection step will be skipped
     Settings* withProjectIterations(int projectionIterations);
 
+    // Returns the solver used for the pressure equation during projection
+    PressureSolver getPressureSolver();
+    // Sets the solver used for the pressure equation during projection
+    // With multigrid, the projection iterations are the number of V-cycles, where a cycle costs about as much as
+    // 8 jacobi iterations. See comment on PressureSolver for details on the solvers
+    Settings* withPressureSolver(PressureSolver pressureSolver);
+
+    // Returns the mean absolute residual of the pressure equation at which projection stops iterating
+    float getPressureTolerance();
+    // Sets the mean absolute residual of the pressure equation at which projection stops iterating, in 1/s
+    // If the tolerance is 0, all projection iterations are always run. Otherwise they are the most that are run,
+    // and the residual is read back from the GPU as it becomes available, so it can be a few iterations old
+    Settings* withPressureTolerance(float pressureTolerance);
+
+    // Returns the relaxation method used by iterations of diffusion and projection
+    Relaxation getRelaxation();
+    // Returns the over-relaxation factor used by the redBlack relaxation
+    float getOverRelaxation();
+    // Sets the relaxation method used by iterations of diffusion and projection, and its over-relaxation factor
+    // A factor of 1 gives plain gauss-seidel, and the factor should be below 2 to converge
+    // See comment on Relaxation for details on the methods
+    Settings* withRelaxation(Relaxation relaxation, float overRelaxation);
+
+    // Returns the scheme used to advect the fields of a specific resolution
+    AdvectionScheme getAdvectionScheme(Resolution res);
+    // Sets the scheme used to advect the fields of a specific resolution
+    // See comment on AdvectionScheme for details on the schemes
+    Settings* withAdvectionScheme(Resolution res, AdvectionScheme scheme);
+
     // Returns the scale factor for buoyancy
     float getBuoyancyScale();
     // Sets the scale factor for buoyancy
@@ -201,6 +294,49 @@ public:
     vec3 getColorSpace();
     Settings* withColorSpace(vec3 colorSpace);
 
+    // Returns the length of the steps that rays are marched with, in cells of the substance
+    float getRayStepSize();
+    // Returns the transmittance below which rays stop being marched
+    float getRayTransmittanceThreshold();
+    // Sets the length of the steps that rays are marched with, in cells of the substance, when a cell covers a pixel.
+    // Steps get longer when the cells are smaller than a pixel. Rays stop being marched when the transmittance to the
+    // camera falls below the threshold, since nothing further away can be seen then
+    Settings* withRayMarching(float stepSize, float transmittanceThreshold);
+
+    // Returns whether the rendered images are accumulated over time
+    bool getTemporalAccumulation();
+    // Sets whether the rendered images are accumulated over time. Rays are then marched with longer steps that start
+    // at a different offset each frame, and each image is blended with the last ones, which are reprojected to where
+    // the fire was seen from in the last frame
+    Settings* withTemporalAccumulation(bool temporalAccumulation);
+
+    // Returns whether the resolution of the ray marching changes to keep its time on the GPU at the target
+    bool getDynamicResolution();
+    // Returns the time in milliseconds that the ray marching should take on the GPU
+    float getRenderTargetTime();
+    // Returns the lowest and highest scale of the ray marching resolution
+    vec2 getRenderScaleBounds();
+    // Sets whether the resolution of the ray marching changes to keep its time on the GPU at the target time, in
+    // milliseconds, between the scale bounds. A scale of 1 has about as many pixels across as cells of the substance.
+    // The time is measured with GL_EXT_disjoint_timer_query, without which the scale stays at 1
+    Settings* withDynamicResolution(bool dynamicResolution, float targetTime, float minScale, float maxScale);
+
+    // Returns whether the renderer gets the substance as an 8 bit copy
+    bool getRenderProxy();
+    // Returns the temperatures that are stored as 0 and 1 in the 8 bit copy of the substance
+    vec2 getRenderProxyTemperatures();
+    // Sets whether the simulator ends each step by copying the substance to 8 bits per channel for the renderer, which
+    // then reads half as much per sample. The temperature is mapped from between the given temperatures, and the
+    // density is kept as is, up to 1 where it is opaque anyway. Only read when the fields are created
+    Settings* withRenderProxy(bool renderProxy, float minTemperature, float maxTemperature);
+
+    // Returns whether rays are only marched in the tiles of the image where the fire can be seen
+    bool getTiledRayMarching();
+    // Sets whether the image is split into tiles, which are listed by projecting the bricks of the substance that have
+    // density onto them, so that rays are only marched by a compute shader in the tiles that the fire covers. Otherwise
+    // a ray is marched for every pixel that the box of the substance covers
+    Settings* withTiledRayMarching(bool tiledRayMarching);
+
     bool getTouchMode();
     Settings* withTouchMode(bool touchMode);
 
@@ -237,6 +373,41 @@ public:
     BoundaryType  getBoundaryType();
     Settings* withBoundaryType(BoundaryType boundaryType);
 
+    // Returns the backend used to execute slab operations
+    SlabBackend getSlabBackend();
+    // Sets the backend used to execute slab operations. Only read when the simulator is initialized
+    // See comment on SlabBackend for details on the backends
+    Settings* withSlabBackend(SlabBackend slabBackend);
+
+    // Returns the layout used by the fields of a specific resolution
+    FieldLayout getFieldLayout(Resolution res);
+    // Sets the layout used by the fields of a specific resolution
+    // See comment on FieldLayout for details on the layouts
+    Settings* withFieldLayout(Resolution res, FieldLayout layout);
+
+    // Returns the precision that a kind of field is stored with
+    Precision getFieldPrecision(FieldKind kind);
+    // Sets the precision that a kind of field is stored with. Only read when the fields are created
+    // See comment on Precision for details on the precisions
+    Settings* withFieldPrecision(FieldKind kind, Precision precision);
+
+    // Returns whether sources, forces and dissipation are fused into the advection passes
+    bool getOperatorFusion();
+    // Sets whether sources, forces and dissipation are fused into the advection passes, which gives about the same
+    // result as the separate passes, but reads and writes each field fewer times
+    Settings* withOperatorFusion(bool operatorFusion);
+
+    // Returns whether operations on the substance resolution skip the bricks that the fire doesn't occupy
+    bool getActiveBricks();
+    // Returns the density, temperature and speed above which a cell is occupied by the fire
+    vec3 getActiveBrickThresholds();
+    // Sets whether operations on the substance resolution skip the bricks that the fire doesn't occupy, and the
+    // density, temperature and speed (in meters/second) above which a cell is occupied. Only read when the fields are
+    // created. The cells that are skipped keep older values, so the thresholds should be low enough for those to be
+    // negligible, while the velocity reaches much further than the fire, so a low speed threshold makes most bricks
+    // active. See comment on ActiveBricks for details
+    Settings* withActiveBricks(bool activeBricks, float densityThreshold, float temperatureThreshold, float speedThreshold);
+
 };
 
 #endif //DATX02_20_21_SETTINGS_H
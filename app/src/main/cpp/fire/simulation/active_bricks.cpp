@@ -0,0 +1,120 @@
+#include "active_bricks.h"
+#include "fire/util/helper.h"
+
+#include <string>
+#include <vector>
+
+#include <android/log.h>
+
+#define LOG_TAG "Active bricks"
+#define LOG_ERROR(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOG_INFO(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+
+int ActiveBricks::init(SlabOperation* slab) {
+    this->slab = slab;
+
+    bool success = slab->load(occupancyShader, "shaders/simulation/slab.vert", "shaders/simulation/bricks/occupancy.frag",
+            {{"BRICK_SIZE", std::to_string(BRICK_SIZE)}});
+    if(!success)
+        LOG_ERROR("Failed to compile active brick shaders");
+    return success;
+}
+
+void ActiveBricks::initTextures(ivec3 size, vec3 thresholds) {
+    clearTextures();
+
+    fieldSize = size;
+    this->thresholds = thresholds;
+    ivec3 bricks = (size + BRICK_SIZE - 1) / BRICK_SIZE;
+    occupancy = createScalarDataPair(nullptr, bricks, 1.0f, FieldLayout::volume, Precision::full);
+
+    LOG_INFO("Tracking %d, %d, %d bricks", bricks.x, bricks.y, bricks.z);
+}
+
+void ActiveBricks::clearTextures() {
+    delete occupancy;
+    occupancy = nullptr;
+
+    occupancyReader.clear();
+
+    occupied.clear();
+    age = -1;
+    regions.clear();
+}
+
+bool ActiveBricks::step() {
+    if(occupancyReader.reading())
+        measurementAge++;
+    if(readOccupancy())
+        age = measurementAge;
+    else if(age >= 0)
+        age++;
+    else return false;
+
+    updateRegions();
+    return true;
+}
+
+void ActiveBricks::measure(DataTexturePair* substance, DataTexturePair* velocity, GLuint source) {
+    if(occupancy == nullptr || occupancyReader.reading())
+        return;
+
+    occupancyShader.use();
+    occupancyShader.uniform3f("thresholds", thresholds);
+    substance->bindData(GL_TEXTURE0);
+    velocity->bindData(GL_TEXTURE1);
+    bindData(source, GL_TEXTURE2);
+    slab->fullOperation(occupancyShader, occupancy);
+
+    occupancyReader.start(occupancy);
+    measurementAge = 0;
+}
+
+bool ActiveBricks::readOccupancy() {
+    if(!occupancyReader.poll(occupancies))
+        return false;
+
+    occupied.resize(occupancies.size());
+    for(size_t i = 0; i < occupancies.size(); i++)
+        occupied[i] = occupancies[i] > 0.5f;
+    return true;
+}
+
+const std::vector<SlabRegion>& ActiveBricks::getRegions() {
+    return regions;
+}
+
+void ActiveBricks::updateRegions() {
+    ivec3 size = occupancy->getSize();
+    int radius = age;
+
+    // The bounds of the active bricks in each brick layer, where a brick is active if an occupied brick
+    // is within the radius along every axis
+    std::vector<ivec2> layerMin(size.z, size), layerMax(size.z, ivec2(-1));
+    for(int z = 0; z < size.z; z++) {
+        for(int y = 0; y < size.y; y++) {
+            for(int x = 0; x < size.x; x++) {
+                if(!occupied[(z * size.y + y) * size.x + x])
+                    continue;
+                ivec3 first = max(ivec3(x, y, z) - radius, ivec3(0));
+                ivec3 last = min(ivec3(x, y, z) + radius, size - 1);
+                for(int layer = first.z; layer <= last.z; layer++) {
+                    layerMin[layer] = min(layerMin[layer], ivec2(first));
+                    layerMax[layer] = max(layerMax[layer], ivec2(last));
+                }
+            }
+        }
+    }
+
+    regions.clear();
+    for(int z = 0; z < size.z; z++) {
+        if(layerMax[z].x < 0)
+            continue;
+        ivec3 offset = ivec3(layerMin[z], z) * BRICK_SIZE;
+        ivec3 end = min(ivec3(layerMax[z] + 1, z + 1) * BRICK_SIZE, fieldSize);
+        if(!regions.empty() && regions.back().end.z == offset.z
+                && ivec2(regions.back().offset) == ivec2(offset) && ivec2(regions.back().end) == ivec2(end))
+            regions.back().end.z = end.z;
+        else regions.push_back(SlabRegion{offset, end});
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef DATX02_20_21_ACTIVE_BRICKS_H
+#define DATX02_20_21_ACTIVE_BRICKS_H
+
+#include <GLES3/gl31.h>
+
+#include <vector>
+
+#include "slab_operation.h"
+#include "fire/util/data_texture_pair.h"
+#include "fire/util/field_reader.h"
+#include "fire/util/shader.h"
+
+// Size of the bricks along each axis, in cells of the substance resolution
+#define BRICK_SIZE 8
+
+// Tracks which bricks of the substance resolution the fire occupies, so that operations can skip the rest.
+// The occupancy is measured on the GPU and read back without waiting for it, so it is a few steps old when it is
+// used. To still cover the fire, the occupied bricks are dilated by one brick for every step since they were
+// measured, including the step that the regions are used for, which assumes that nothing moves further than a brick
+// in a step.
+class ActiveBricks {
+    SlabOperation* slab;
+
+    Shader occupancyShader;
+
+    // One cell per brick, set to 1 if the brick is occupied
+    DataTexturePair* occupancy = nullptr;
+    ivec3 fieldSize;
+    vec3 thresholds;
+
+    // Reads the measured occupancy back, which is ready a few steps later
+    FieldReader occupancyReader;
+    std::vector<float> occupancies;
+    // Steps since the measurement in progress was started
+    int measurementAge = 0;
+
+    // The last occupancy that was read, and the number of steps since it was measured (counting the current step),
+    // or -1 if there is none yet
+    std::vector<bool> occupied;
+    int age = -1;
+
+    std::vector<SlabRegion> regions;
+
+public:
+    int init(SlabOperation* slab);
+
+    // Creates the fields for tracking a substance field of the given size
+    // A cell is occupied if its density, temperature or speed is above the respective threshold
+    void initTextures(ivec3 size, vec3 thresholds);
+
+    void clearTextures();
+
+    // Advances the tracking by one step, and reads the occupancy if it has been measured since the last step
+    // Returns whether there are regions to restrict operations to, which is not the case until the first is read
+    bool step();
+
+    // Starts measuring the occupancy of the given substance, its source and velocity of the same resolution
+    // Does nothing if a measurement is already in progress
+    void measure(DataTexturePair* substance, DataTexturePair* velocity, GLuint source);
+
+    // Returns the regions of the substance resolution that cover the active bricks, with one region
+    // for every run of brick layers where the active bricks have the same bounds
+    const std::vector<SlabRegion>& getRegions();
+
+private:
+    // Reads the occupancy into occupied, and returns whether it had been measured
+    bool readOccupancy();
+
+    void updateRegions();
+};
+
+#endif //DATX02_20_21_ACTIVE_BRICKS_H
@@ -108,6 +108,14 @@ vec3* createVectorField(vec3 value, ivec3 gridSize) {
     return field;
 }
 
+vec2* createPairField(float* first, float* second, ivec3 gridSize) {
+    int count = gridSize.x * gridSize.y * gridSize.z;
+    vec2* field = new vec2[count];
+    for (int i = 0; i < count; i++)
+        field[i] = vec2(first[i], second[i]);
+    return field;
+}
+
 void fillField(float *field, float value, vec3 minPos, vec3 maxPos, Resolution res, Settings* settings) {
     int border = 1;
     ivec3 gridSize = settings->getSize(res);
@@ -18,6 +18,9 @@ float* createScalarField(float value, ivec3 gridSize);
 // creates a field array to use for texture creation, that need to be deleted after use
 vec3* createVectorField(vec3 value, ivec3 gridSize);
 
+// creates a pair field array from two scalar fields of the same size, that need to be deleted after use
+vec2* createPairField(float* first, float* second, ivec3 gridSize);
+
 // value is in unit
 void fillField(float* field, float value, vec3 minPos, vec3 maxPos, Resolution res, Settings* settings);
 void fillField(vec3* field, vec3 value, vec3 minPos, vec3 maxPos, Resolution res, Settings* settings);
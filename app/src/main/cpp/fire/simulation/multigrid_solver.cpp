@@ -0,0 +1,181 @@
+#include "multigrid_solver.h"
+
+#include <vector>
+
+#include <android/log.h>
+
+#define LOG_TAG "Multigrid solver"
+#define LOG_ERROR(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOG_INFO(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+
+int MultigridSolver::init(SlabOperation* slab) {
+    this->slab = slab;
+
+    bool success = true;
+    // The weight 6/7 damps the highest frequencies of the 7-point laplacian the most
+    success &= slab->load(smoothShader, "shaders/simulation/slab.vert", "shaders/simulation/projection/jacobi.frag",
+            {{"SCALAR_FIELD", ""}, {"JACOBI_WEIGHT", "(6.0 / 7.0)"}});
+    success &= slab->load(residualShader, "shaders/simulation/slab.vert", "shaders/simulation/projection/residual.frag");
+    success &= slab->load(absoluteResidualShader, "shaders/simulation/slab.vert",
+            "shaders/simulation/projection/residual.frag", {{"ABSOLUTE_RESIDUAL", ""}});
+    success &= slab->load(restrictionShader, "shaders/simulation/slab.vert", "shaders/simulation/projection/restriction.frag");
+    success &= slab->load(prolongationShader, "shaders/simulation/slab.vert", "shaders/simulation/projection/prolongation.frag");
+    if(!success)
+        LOG_ERROR("Failed to compile multigrid shaders");
+    return success;
+}
+
+void MultigridSolver::initTextures(ivec3 size, float scaleFactor, FieldLayout layout, Precision precision) {
+    clearTextures();
+    fieldSize = size;
+    fieldScaleFactor = scaleFactor;
+    fieldLayout = layout;
+    fieldPrecision = precision;
+    levelsCreated = false;
+}
+
+bool MultigridSolver::createLevels() {
+    if(levelsCreated)
+        return !levels.empty();
+    levelsCreated = true;
+
+    float scaleFactor = fieldScaleFactor;
+    ivec3 interior = fieldSize - 2;
+    MultigridLevel finest = {nullptr, nullptr,
+            createScalarDataPair(nullptr, fieldSize, scaleFactor, fieldLayout, fieldPrecision)};
+    levels.push_back(finest);
+    while(true) {
+        interior = (interior + 1) / 2;
+        if(interior.x < MULTIGRID_MIN_SIZE || interior.y < MULTIGRID_MIN_SIZE || interior.z < MULTIGRID_MIN_SIZE)
+            break;
+        // Cells of the coarser level are twice as large
+        scaleFactor *= 0.5f;
+        MultigridLevel level = {
+                createScalarDataPair(nullptr, interior + 2, scaleFactor, fieldLayout, fieldPrecision),
+                createScalarDataPair(nullptr, interior + 2, scaleFactor, fieldLayout, fieldPrecision),
+                createScalarDataPair(nullptr, interior + 2, scaleFactor, fieldLayout, fieldPrecision)};
+        levels.push_back(level);
+    }
+    if(levels.size() == 1) {
+        LOG_ERROR("The field is too small for multigrid");
+        clearTextures();
+        return false;
+    }
+    // The coarsest level is only smoothed, so it doesn't need a residual
+    delete levels.back().residual;
+    levels.back().residual = nullptr;
+
+    LOG_INFO("Created %d multigrid levels, the coarsest of size %d, %d, %d", (int) levels.size(),
+            interior.x, interior.y, interior.z);
+    return true;
+}
+
+void MultigridSolver::clearTextures() {
+    for(size_t i = 0; i < levels.size(); i++) {
+        if(i != 0) {
+            delete levels[i].x;
+            delete levels[i].b;
+        }
+        delete levels[i].residual;
+    }
+    levels.clear();
+
+    residualReader.clear();
+}
+
+void MultigridSolver::solve(DataTexturePair* x, DataTexturePair* b, int cycles) {
+    if(!createLevels())
+        return;
+    levels[0].x = x;
+    levels[0].b = b;
+    for(int i = 0; i < cycles; i++)
+        vCycle(0);
+}
+
+void MultigridSolver::measureResidual(DataTexturePair* x, DataTexturePair* b) {
+    if(measuring() || !createLevels())
+        return;
+
+    absoluteResidualShader.use();
+    absoluteResidualShader.uniform1f("dh", 1.0f / x->toVoxelScaleFactor());
+    x->bindData(GL_TEXTURE0);
+    b->bindData(GL_TEXTURE1);
+    DataTexturePair* reduced = levels[0].residual;
+    slab->interiorOperation(absoluteResidualShader, reduced, 0);
+
+    // Every restriction averages the residual over twice the cells along each axis
+    for(size_t i = 1; i < levels.size(); i++) {
+        restrictionShader.use();
+        reduced->bindData(GL_TEXTURE0);
+        slab->interiorOperation(restrictionShader, levels[i].b, 0);
+        reduced = levels[i].b;
+    }
+
+    residualReader.start(reduced);
+}
+
+bool MultigridSolver::measuring() {
+    return residualReader.reading();
+}
+
+bool MultigridSolver::readResidual(float& residual) {
+    if(!residualReader.poll(residuals))
+        return false;
+
+    ivec3 size = levels.back().b->getSize();
+    double sum = 0.0;
+    for(int z = 1; z < size.z - 1; z++) {
+        for(int y = 1; y < size.y - 1; y++) {
+            for(int x = 1; x < size.x - 1; x++)
+                sum += residuals[(z * size.y + y) * size.x + x];
+        }
+    }
+
+    residual = (float) (sum / ((size.x - 2) * (size.y - 2) * (size.z - 2)));
+    return true;
+}
+
+void MultigridSolver::vCycle(size_t level) {
+    MultigridLevel& current = levels[level];
+    if(level + 1 == levels.size()) {
+        smooth(current, MULTIGRID_COARSE_ITERATIONS);
+        return;
+    }
+    MultigridLevel& coarse = levels[level + 1];
+
+    smooth(current, MULTIGRID_SMOOTHING_ITERATIONS);
+
+    residualShader.use();
+    residualShader.uniform1f("dh", 1.0f / current.x->toVoxelScaleFactor());
+    current.x->bindData(GL_TEXTURE0);
+    current.b->bindData(GL_TEXTURE1);
+    slab->interiorOperation(residualShader, current.residual, 0);
+
+    restrictionShader.use();
+    current.residual->bindData(GL_TEXTURE0);
+    slab->interiorOperation(restrictionShader, coarse.b, 0);
+
+    coarse.x->clearData();
+    vCycle(level + 1);
+
+    prolongationShader.use();
+    current.x->bindData(GL_TEXTURE0);
+    coarse.x->bindData(GL_TEXTURE1);
+    slab->interiorOperation(prolongationShader, current.x, 1);
+
+    smooth(current, MULTIGRID_SMOOTHING_ITERATIONS);
+}
+
+void MultigridSolver::smooth(MultigridLevel& level, int iterations) {
+    float dx = 1.0f / level.x->toVoxelScaleFactor();
+
+    level.b->bindData(GL_TEXTURE1);
+    for(int i = 0; i < iterations; i++) {
+        smoothShader.use();
+        smoothShader.uniform1f("alpha", -(dx * dx));
+        smoothShader.uniform1f("beta", 6.0f);
+        level.x->bindData(GL_TEXTURE0);
+
+        slab->interiorOperation(smoothShader, level.x, 1);
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef DATX02_20_21_MULTIGRID_SOLVER_H
+#define DATX02_20_21_MULTIGRID_SOLVER_H
+
+#include <GLES3/gl31.h>
+
+#include <vector>
+
+#include "slab_operation.h"
+#include "fire/util/data_texture_pair.h"
+#include "fire/util/field_reader.h"
+#include "fire/util/shader.h"
+
+// Smoothing iterations before and after the correction from the coarser level, on every level but the coarsest
+#define MULTIGRID_SMOOTHING_ITERATIONS 2
+// Smoothing iterations on the coarsest level, which stand in for solving it exactly
+#define MULTIGRID_COARSE_ITERATIONS 16
+// Levels are added until the interior of the next one would be smaller than this along any axis
+#define MULTIGRID_MIN_SIZE 2
+
+// A level of the multigrid hierarchy, where x is the solution of Ax = b and residual holds b - Ax
+// On the finest level x and b are the fields being solved for, on the coarser levels x is the correction
+struct MultigridLevel {
+    DataTexturePair* x;
+    DataTexturePair* b;
+    DataTexturePair* residual;
+};
+
+// Solves the pressure equation with geometric multigrid V-cycles. Each cycle smooths the error with weighted
+// jacobi iteration, restricts the residual to a field of half the resolution where the remaining low frequency
+// error is solved for recursively, and adds the correction back. The boundaries are set like for the pressure.
+// The levels are also used to reduce the residual to its mean, which is read back without waiting for the GPU.
+class MultigridSolver {
+    SlabOperation* slab;
+
+    Shader smoothShader, residualShader, restrictionShader, prolongationShader;
+    Shader absoluteResidualShader;
+
+    // From the finest to the coarsest. The fields of the finest level except the residual are given to solve()
+    std::vector<MultigridLevel> levels;
+
+    // The fields that the levels are created for the first time they are needed, see initTextures()
+    ivec3 fieldSize = ivec3(0);
+    float fieldScaleFactor = 1.0f;
+    FieldLayout fieldLayout = FieldLayout::volume;
+    Precision fieldPrecision = Precision::half;
+    bool levelsCreated = false;
+
+    // Reads the reduced residual from the coarsest level
+    FieldReader residualReader;
+    std::vector<float> residuals;
+
+public:
+    int init(SlabOperation* slab);
+
+    // Sets up solving fields of the given size, scale, layout and precision. The fields of the coarser levels are
+    // only created once they are first needed by solve() or measureResidual(), so that nothing is allocated as long
+    // as neither the multigrid solver nor a pressure tolerance is used.
+    void initTextures(ivec3 size, float scaleFactor, FieldLayout layout, Precision precision);
+
+    // Improves the solution x of the pressure equation with the divergence b by running the given number of V-cycles
+    void solve(DataTexturePair* x, DataTexturePair* b, int cycles);
+
+    // Starts measuring the mean absolute residual of the pressure equation, which is read with readResidual()
+    // Only one measurement can be in progress at a time
+    void measureResidual(DataTexturePair* x, DataTexturePair* b);
+
+    // Returns true if a measurement is in progress
+    bool measuring();
+
+    // Returns true and sets the residual if the measurement in progress has finished, which ends it
+    bool readResidual(float& residual);
+
+private:
+    // Creates the fields of the levels if they haven't been created yet
+    // Returns false if the fields are too small for multigrid
+    bool createLevels();
+
+    void clearTextures();
+
+    void vCycle(size_t level);
+
+    // Runs weighted jacobi iterations on the solution of the level
+    void smooth(MultigridLevel& level, int iterations);
+};
+
+#endif //DATX02_20_21_MULTIGRID_SOLVER_H
@@ -0,0 +1,74 @@
+#include "operator_fusion.h"
+
+#include <string>
+
+#include <android/log.h>
+
+#include "fire/util/shader_preprocessor.h"
+
+#define LOG_TAG "Operator fusion"
+#define LOG_ERROR(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOG_INFO(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+
+struct FusedStageSource {
+    FusedStage stage;
+    const char* path;
+    const char* function;
+};
+
+// In the order that the stages are applied
+static const FusedStageSource stageSources[] = {
+        {BUOYANCY, "shaders/simulation/fused/buoyancy.glsl", "buoyancy"},
+        {WIND, "shaders/simulation/fused/wind.glsl", "wind"},
+        {EXTERNAL_FORCE, "shaders/simulation/fused/external_force.glsl", "externalForce"},
+        {ADD_SOURCE, "shaders/simulation/fused/add_source.glsl", "addSource"},
+        {SET_SOURCE, "shaders/simulation/fused/set_source.glsl", "setSource"},
+        {DISSIPATION, "shaders/simulation/fused/dissipation.glsl", "dissipation"},
+};
+
+static void replaceMarker(std::string& source, const std::string& marker, const std::string& code) {
+    size_t position = source.find(marker);
+    if(position != std::string::npos)
+        source.replace(position, marker.size(), code);
+}
+
+void OperatorFusion::init(SlabOperation* slab) {
+    this->slab = slab;
+}
+
+Shader* OperatorFusion::advection(unsigned stages, bool macCormack) {
+    auto key = std::make_pair(stages, macCormack);
+    auto found = shaders.find(key);
+    if(found != shaders.end())
+        return &found->second;
+
+    ShaderDefines defines;
+    if(macCormack)
+        defines["MACCORMACK"] = "";
+    if(stages & VELOCITY_STAGES)
+        defines["SELF_ADVECTION"] = "";
+    std::string source = loadShaderSource("shaders/simulation/fused/advection.frag", defines);
+    std::string functions, sources, calls;
+    for(const FusedStageSource& stage : stageSources) {
+        if(!(stages & stage.stage))
+            continue;
+        functions += loadShaderSource(stage.path) + "\n";
+        std::string call = std::string("value = ") + stage.function + "(value, position);\n    ";
+        if(stage.stage & AFTER_ADVECTION)
+            calls += call;
+        else sources += call;
+    }
+    replaceMarker(source, "// FUSED STAGES", functions);
+    replaceMarker(source, "// FUSED SOURCES", sources);
+    replaceMarker(source, "// FUSED CALLS", calls);
+
+    Shader shader;
+    std::string name = "shaders/simulation/fused/advection.frag (stages " + std::to_string(stages)
+            + (macCormack ? ", MacCormack)" : ")");
+    if(!slab->loadSource(shader, "shaders/simulation/slab.vert", source, name.c_str())) {
+        LOG_ERROR("Failed to generate fused advection shader with stages %u", stages);
+        return nullptr;
+    }
+    shaders[key] = shader;
+    return &shaders[key];
+}
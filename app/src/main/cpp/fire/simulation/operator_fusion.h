@@ -0,0 +1,48 @@
+#ifndef DATX02_20_21_OPERATOR_FUSION_H
+#define DATX02_20_21_OPERATOR_FUSION_H
+
+#include <GLES3/gl31.h>
+
+#include <map>
+
+#include "slab_operation.h"
+#include "fire/util/shader.h"
+
+// Texture slots read by the fused stages, in addition to the velocity (GL_TEXTURE0) and advected data (GL_TEXTURE1)
+#define FUSED_SUBSTANCE_SLOT GL_TEXTURE2
+#define FUSED_FORCE_SLOT GL_TEXTURE3
+#define FUSED_SOURCE_SLOT GL_TEXTURE4
+
+// Pointwise stages that can be fused into the advection pass, which are applied in the order they are listed
+// The sources and forces are applied to each cell that the advection interpolates from, as if they had been applied
+// before the advection, while the stages of AFTER_ADVECTION are applied to the advected value
+enum FusedStage {
+    BUOYANCY = 1 << 0,
+    WIND = 1 << 1,
+    EXTERNAL_FORCE = 1 << 2,
+    ADD_SOURCE = 1 << 3,
+    SET_SOURCE = 1 << 4,
+    DISSIPATION = 1 << 5
+};
+const unsigned AFTER_ADVECTION = DISSIPATION;
+// Stages of the velocity, which is advected by itself, so that the stages also change how it is traced back
+const unsigned VELOCITY_STAGES = BUOYANCY | WIND | EXTERNAL_FORCE;
+
+// Generates advection shaders with a combination of pointwise stages fused into them, so that
+// a field is read and written once instead of once per stage
+class OperatorFusion {
+    SlabOperation* slab;
+
+    // indexed by the combined stages, and whether the shader performs the correction of MacCormack advection
+    std::map<std::pair<unsigned, bool>, Shader> shaders;
+
+public:
+    void init(SlabOperation* slab);
+
+    // Returns the advection shader with the given stages fused into it, which is generated the first time
+    // With macCormack set, it corrects a semi-lagrangian result instead, see advect.glsl
+    // Returns nullptr if the shader could not be created
+    Shader* advection(unsigned stages, bool macCormack = false);
+};
+
+#endif //DATX02_20_21_OPERATOR_FUSION_H
@@ -6,6 +6,7 @@
 #include "simulation_operations.h"
 #include "fire/util/helper.h"
 
+#include <algorithm>
 #include <android/log.h>
 
 #define LOG_TAG "Simulation operations"
@@ -14,6 +15,13 @@
 
 int SimulationOperations::init(SlabOperation* slab, Settings* settings) {
     this->slab = slab;
+    fusion.init(slab);
+    if(!multigrid.init(slab))
+        return 0;
+    relaxation = settings->getRelaxation();
+    overRelaxation = settings->getOverRelaxation();
+    velocityAdvection = settings->getAdvectionScheme(Resolution::velocity);
+    substanceAdvection = settings->getAdvectionScheme(Resolution::substance);
     
     initTextures(settings);
 
@@ -30,51 +38,84 @@ int SimulationOperations::init(SlabOperation* slab, Settings* settings) {
 int SimulationOperations::initShaders() {
     bool success = true;
     // Advection Shaders
-    success &= advectionShader.load("shaders/simulation/slab.vert", "shaders/simulation/advection/advection.frag");
+    success &= slab->load(advectionShader, "shaders/simulation/slab.vert", "shaders/simulation/advection/advection.frag");
+    success &= slab->load(macCormackShader, "shaders/simulation/slab.vert", "shaders/simulation/advection/advection.frag",
+            {{"MACCORMACK", ""}});
     // Dissipate Shaders
-    success &= dissipateShader.load("shaders/simulation/slab.vert", "shaders/simulation/dissipate/dissipate.frag");
+    success &= slab->load(substanceDissipationShader, "shaders/simulation/slab.vert",
+            "shaders/simulation/dissipate/substance_dissipation.frag");
     // Force Shaders
-    success &= addSourceShader.load("shaders/simulation/slab.vert", "shaders/simulation/force/add_source.frag");
-    success &= setSourceShader.load("shaders/simulation/slab.vert", "shaders/simulation/force/set_source.frag");
-    success &= buoyancyShader.load("shaders/simulation/slab.vert", "shaders/simulation/force/buoyancy.frag");
-    success &= windShader.load("shaders/simulation/slab.vert", "shaders/simulation/force/add_wind.frag");
-    success &= externalForceShader.load("shaders/simulation/slab.vert", "shaders/simulation/force/external_force.frag");
+    success &= slab->load(addSourceShader, "shaders/simulation/slab.vert", "shaders/simulation/force/add_source.frag");
+    success &= slab->load(setSourceShader, "shaders/simulation/slab.vert", "shaders/simulation/force/set_source.frag");
+    success &= slab->load(buoyancyShader, "shaders/simulation/slab.vert", "shaders/simulation/force/buoyancy.frag");
+    success &= slab->load(windShader, "shaders/simulation/slab.vert", "shaders/simulation/force/add_wind.frag");
+    success &= slab->load(externalForceShader, "shaders/simulation/slab.vert", "shaders/simulation/force/external_force.frag");
     // Projection Shaders
-    success &= divergenceShader.load("shaders/simulation/slab.vert", "shaders/simulation/projection/divergence.frag");
-    success &= jacobiShader.load("shaders/simulation/slab.vert", "shaders/simulation/projection/jacobi.frag");
-    success &= gradientShader.load("shaders/simulation/slab.vert", "shaders/simulation/projection/gradient_subtraction.frag");
+    success &= slab->load(divergenceShader, "shaders/simulation/slab.vert", "shaders/simulation/projection/divergence.frag");
+    success &= slab->load(jacobiShader, "shaders/simulation/slab.vert", "shaders/simulation/projection/jacobi.frag");
+    success &= slab->load(scalarJacobiShader, "shaders/simulation/slab.vert", "shaders/simulation/projection/jacobi.frag",
+            {{"SCALAR_FIELD", ""}});
+    success &= slab->load(pairJacobiShader, "shaders/simulation/slab.vert", "shaders/simulation/projection/jacobi.frag",
+            {{"PAIR_FIELD", ""}});
+    success &= slab->load(redBlackShader, "shaders/simulation/slab.vert", "shaders/simulation/projection/red_black.frag");
+    success &= slab->load(scalarRedBlackShader, "shaders/simulation/slab.vert", "shaders/simulation/projection/red_black.frag",
+            {{"SCALAR_FIELD", ""}});
+    success &= slab->load(pairRedBlackShader, "shaders/simulation/slab.vert", "shaders/simulation/projection/red_black.frag",
+            {{"PAIR_FIELD", ""}});
+    success &= slab->load(gradientShader, "shaders/simulation/slab.vert", "shaders/simulation/projection/gradient_subtraction.frag");
     // Vorticity Shaders
-    success &= vorticityShader.load("shaders/simulation/slab.vert", "shaders/simulation/vorticity/vorticity.frag");
-    // Temperature Shaders
-    success &= temperatureShader.load("shaders/simulation/slab.vert", "shaders/simulation/temperature/temperature.frag");
+    success &= slab->load(vorticityShader, "shaders/simulation/slab.vert", "shaders/simulation/vorticity/vorticity.frag");
     return success;
 }
 
 void SimulationOperations::initTextures(Settings* settings) {
 
-    ivec3 lowResSize = settings->getSize(Resolution::velocity);
-    ivec3 highResSize = settings->getSize(Resolution::substance);
+    lowResSize = settings->getSize(Resolution::velocity);
+    highResSize = settings->getSize(Resolution::substance);
+
+    lowScaleFactor = 1.0f/settings->getResToSimFactor(Resolution::velocity);
+    highScaleFactor = 1.0f/settings->getResToSimFactor(Resolution::substance);
+
+    lowResLayout = slab->fieldLayout(settings, Resolution::velocity);
+    highResLayout = slab->fieldLayout(settings, Resolution::substance);
 
-    float lowScaleFactor = 1.0f/settings->getResToSimFactor(Resolution::velocity);
-    float highScaleFactor = 1.0f/settings->getResToSimFactor(Resolution::substance);
+    vectorPrecision = settings->getFieldPrecision(FieldKind::vectors);
+    Precision pressurePrecision = settings->getFieldPrecision(FieldKind::pressure);
+    scalarPrecision = settings->getFieldPrecision(FieldKind::scalars);
 
-    createVector3DTexture(diffusionBHRTexture, highResSize, (vec3*)nullptr);
-    createVector3DTexture(diffusionBLRTexture, lowResSize, (vec3*)nullptr);
+    diffusionBHR = createVectorDataPair(nullptr, highResSize, highScaleFactor, highResLayout, vectorPrecision);
+    diffusionBLR = createVectorDataPair(nullptr, lowResSize, lowScaleFactor, lowResLayout, vectorPrecision);
 
-    divergence = createScalarDataPair(nullptr, lowResSize, lowScaleFactor);
+    divergence = createScalarDataPair(nullptr, lowResSize, lowScaleFactor, lowResLayout, pressurePrecision);
 
-    jacobi = createScalarDataPair(nullptr, lowResSize, lowScaleFactor);
+    jacobi = createScalarDataPair(nullptr, lowResSize, lowScaleFactor, lowResLayout, pressurePrecision);
+
+    // The advection fields are created again with the new settings once they are used
+    delete advectionLR;
+    delete advectionHR;
+    advectionLR = nullptr;
+    advectionHR = nullptr;
+
+    multigrid.initTextures(lowResSize, lowScaleFactor, lowResLayout, pressurePrecision);
 
 }
 
 void SimulationOperations::clearTextures() {
     delete divergence;
     delete jacobi;
-    glDeleteTextures(1, &diffusionBHRTexture);
-    glDeleteTextures(1, &diffusionBLRTexture);
+    delete diffusionBHR;
+    delete diffusionBLR;
+    delete advectionLR;
+    delete advectionHR;
+    advectionLR = nullptr;
+    advectionHR = nullptr;
 }
 
 int SimulationOperations::changeSettings(Settings* settings, bool shouldRegenFields) {
+    relaxation = settings->getRelaxation();
+    overRelaxation = settings->getOverRelaxation();
+    velocityAdvection = settings->getAdvectionScheme(Resolution::velocity);
+    substanceAdvection = settings->getAdvectionScheme(Resolution::substance);
     if(shouldRegenFields) {
         //clearTextures();
         initTextures(settings);
@@ -82,16 +123,17 @@ int SimulationOperations::changeSettings(Settings* settings, bool shouldRegenFie
     return 1;
 }
 
-void SimulationOperations::heatDissipation(DataTexturePair* temperature, float dt){
-    temperatureShader.use();
-    temperatureShader.uniform1f("dt", dt);
-    temperature->bindData(GL_TEXTURE0);
+void SimulationOperations::dissipateSubstance(DataTexturePair* substance, float dissipationRate, float dt){
+    substanceDissipationShader.use();
+    substanceDissipationShader.uniform1f("dt", dt);
+    substanceDissipationShader.uniform1f("dissipation_rate", dissipationRate);
+    substance->bindData(GL_TEXTURE0);
 
-    slab->fullOperation(temperatureShader, temperature);
+    slab->fullOperation(substanceDissipationShader, substance);
 }
 
 void SimulationOperations::addSource(DataTexturePair* data, GLuint source, SourceMode mode, float dt) {
-    Shader shader = mode == SourceMode::add ? addSourceShader : setSourceShader;
+    Shader& shader = mode == SourceMode::add ? addSourceShader : setSourceShader;
 
     shader.use();
     shader.uniform1f("dt", dt);
@@ -101,7 +143,7 @@ void SimulationOperations::addSource(DataTexturePair* data, GLuint source, Sourc
     slab->fullOperation(shader, data);
 }
 
-void SimulationOperations::buoyancy(DataTexturePair* velocity, DataTexturePair* temperature, vec3 direction, float scale, float dt){
+void SimulationOperations::buoyancy(DataTexturePair* velocity, DataTexturePair* substance, vec3 direction, float scale, float dt){
     buoyancyShader.use();
     buoyancyShader.uniform1f("dt", dt);
     buoyancyShader.uniform1f("scale", scale);
@@ -109,65 +151,111 @@ void SimulationOperations::buoyancy(DataTexturePair* velocity, DataTexturePair*
 #pragma ide diagnostic ignored "err_typecheck_invalid_operands"
     // Apply rotation to direction vector, pointing upwards
     buoyancyShader.uniform3f("direction", direction);
-    buoyancyShader.uniform3f("temp_border_width", vec3(1)/vec3(temperature->getSize()));
+    buoyancyShader.uniform3f("temp_border_width", vec3(1)/vec3(substance->getSize()));
 #pragma clang diagnostic pop
     buoyancyShader.uniform3f("gridSize", velocity->getSize());
 
-    temperature->bindData(GL_TEXTURE0);
+    substance->bindData(GL_TEXTURE0);
     velocity->bindData(GL_TEXTURE1);
 
     slab->interiorOperation(buoyancyShader, velocity, -1);
 }
 
-void SimulationOperations::diffuse(DataTexturePair* data, Resolution res, int iterationCount, float kinematicViscosity, float dt) {
+void SimulationOperations::diffuse(DataTexturePair* data, Resolution res, int iterationCount, vec3 kinematicViscosity, float dt) {
 
-    GLuint diffusionTexture = res == Resolution::velocity ? diffusionBLRTexture : diffusionBHRTexture;
-    slab->copy(data, diffusionTexture);
+    DataTexturePair* diffusionB = res == Resolution::velocity ? diffusionBLR : diffusionBHR;
+    slab->copy(data, diffusionB);
 
     float dx = 1.0f / data->toVoxelScaleFactor();
-    float alpha = (dx*dx) / (kinematicViscosity * dt);
-    float beta = 6.0f + alpha; // For 3D grids
+    vec3 alpha, beta;
+    for(int i = 0; i < 3; i++) {
+        // A channel without viscosity is weighted so heavily towards its previous value that it stays the same
+        alpha[i] = kinematicViscosity[i] != 0.0f ? (dx*dx) / (kinematicViscosity[i] * dt) : 1e30f;
+        beta[i] = 6.0f + alpha[i]; // For 3D grids
+    }
 
-    jacobiIteration(data, diffusionTexture, iterationCount, alpha, beta, -1);
+    relax(data, diffusionB, iterationCount, alpha, beta, -1);
 }
 
-void SimulationOperations::dissipate(DataTexturePair* data, float dissipationRate, float dt){
+void SimulationOperations::advectionUniforms(Shader& shader, DataTexturePair* velocity, float dt) {
+    shader.uniform1f("dt", dt);
+    shader.uniform1f("meterToVoxels", velocity->toVoxelScaleFactor());
+    shader.uniform3f("gridSize", velocity->getSize());
+}
 
-    dissipateShader.use();
-    dissipateShader.uniform1f("dt", dt);
-    dissipateShader.uniform1f("dissipation_rate", dissipationRate);
-    data->bindData(GL_TEXTURE0);
+bool SimulationOperations::usesMacCormack(Resolution res) {
+    AdvectionScheme scheme = res == Resolution::velocity ? velocityAdvection : substanceAdvection;
+    return scheme == AdvectionScheme::macCormack;
+}
 
-    slab->fullOperation(dissipateShader, data);
+bool SimulationOperations::advectForward(DataTexturePair* velocity, DataTexturePair* data, Resolution res, float dt,
+        Shader* shader) {
+    if(!usesMacCormack(res))
+        return false;
+
+    // The field is only needed by MacCormack advection, which the settings can switch to at any time
+    DataTexturePair*& forward = res == Resolution::velocity ? advectionLR : advectionHR;
+    if(forward == nullptr) {
+        // Creating the field binds it to the active unit, which must not be one of the inputs that are already bound
+        glActiveTexture(GL_TEXTURE0);
+        forward = res == Resolution::velocity
+                ? createVectorDataPair(nullptr, lowResSize, lowScaleFactor, lowResLayout, vectorPrecision)
+                : createPairDataPair(nullptr, highResSize, highScaleFactor, highResLayout, scalarPrecision);
+    }
+    Shader& forwardShader = shader != nullptr ? *shader : advectionShader;
+    forwardShader.use();
+    advectionUniforms(forwardShader, velocity, dt);
+    velocity->bindData(GL_TEXTURE0);
+    data->bindData(GL_TEXTURE1);
+
+    slab->fullOperation(forwardShader, forward);
+    forward->bindData(MACCORMACK_FORWARD_SLOT);
+    return true;
 }
 
-void SimulationOperations::advect(DataTexturePair* velocity, DataTexturePair* data, bool applyVelocityBorder, float dt) {
-    advectionShader.use();
-    advectionShader.uniform1f("dt", dt);
-    advectionShader.uniform1f("meterToVoxels", velocity->toVoxelScaleFactor());
-    advectionShader.uniform3f("gridSize", velocity->getSize());
+void SimulationOperations::advect(DataTexturePair* velocity, DataTexturePair* data, Resolution res,
+        bool applyVelocityBorder, float dt) {
+    Shader& shader = advectForward(velocity, data, res, dt) ? macCormackShader : advectionShader;
+    shader.use();
+    advectionUniforms(shader, velocity, dt);
     velocity->bindData(GL_TEXTURE0);
     data->bindData(GL_TEXTURE1);
 
     if(applyVelocityBorder)
-        slab->interiorOperation(advectionShader, data, -1);
-    else slab->fullOperation(advectionShader, data);
+        slab->interiorOperation(shader, data, -1);
+    else slab->fullOperation(shader, data);
 }
 
-void SimulationOperations::project(DataTexturePair* velocity, int iterationCount){
+void SimulationOperations::project(DataTexturePair* velocity, PressureSolver solver, int iterationCount, float tolerance){
     float dx = 1.0f/velocity->toVoxelScaleFactor();
     float alpha = -(dx*dx);
     float beta = 6.0f;
 
-    int zSize = velocity->getSize().z;
-    // Clear gradient texture, unsure if needed?
-    for(int depth = 0; depth < zSize; depth++){
-        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, jacobi->getDataTexture(), 0, depth);
-        glClear(GL_COLOR_BUFFER_BIT);
-    }
-
+    // The pressure changes little between steps, so the previous pressure is kept as the initial guess
     createDivergence(velocity, dx);
-    jacobiIteration(jacobi, divergence->getDataTexture(), iterationCount, alpha, beta, 1);
+
+    int interval = iterationCount;
+    if(tolerance > 0.0f)
+        interval = solver == PressureSolver::multigrid ? 1 : PRESSURE_CHECK_INTERVAL;
+    // A measurement left from the previous step is of another divergence, so it can't end this solve
+    bool stale = multigrid.measuring();
+    for(int i = 0; i < iterationCount; i += interval){
+        int iterations = std::min(interval, iterationCount - i);
+        if(solver == PressureSolver::multigrid)
+            multigrid.solve(jacobi, divergence, iterations);
+        else relax(jacobi, divergence, iterations, vec3(alpha), vec3(beta), 1);
+
+        if(tolerance <= 0.0f || i + iterations >= iterationCount)
+            break;
+        float residual;
+        if(multigrid.readResidual(residual)){
+            if(!stale && residual < tolerance)
+                break;
+            stale = false;
+        }
+        if(!multigrid.measuring())
+            multigrid.measureResidual(jacobi, divergence);
+    }
     subtractGradient(velocity, dx);
 }
 
@@ -189,17 +277,54 @@ void SimulationOperations::createDivergence(DataTexturePair* vectorData, float d
     slab->interiorOperation(divergenceShader, divergence, 1);
 }
 
-void SimulationOperations::jacobiIteration(DataTexturePair *xTexturePair, GLuint bTexture,
-                                   int iterationCount, float alpha, float beta, int scale){
+// Sets a uniform of the field type of the given field (field_t in the shaders), from the first channels of the value
+static void uniformField(Shader& shader, const GLchar* name, TextureType type, vec3 value) {
+    switch(type) {
+        case SCALAR: shader.uniform1f(name, value.x); break;
+        case PAIR: shader.uniform2f(name, vec2(value)); break;
+        case VECTOR: shader.uniform3f(name, value); break;
+    }
+}
+
+void SimulationOperations::relax(DataTexturePair *xTexturePair, DataTexturePair* bTexturePair,
+                                 int iterationCount, vec3 alpha, vec3 beta, int scale){
+    if(relaxation == Relaxation::redBlack)
+        redBlackIteration(xTexturePair, bTexturePair, iterationCount, alpha, beta, scale);
+    else jacobiIteration(xTexturePair, bTexturePair, iterationCount, alpha, beta, scale);
+}
+
+void SimulationOperations::jacobiIteration(DataTexturePair *xTexturePair, DataTexturePair* bTexturePair,
+                                   int iterationCount, vec3 alpha, vec3 beta, int scale){
 
-    bindData(bTexture, GL_TEXTURE1);
+    TextureType type = xTexturePair->getType();
+    Shader& shader = type == SCALAR ? scalarJacobiShader : type == PAIR ? pairJacobiShader : jacobiShader;
+    bTexturePair->bindData(GL_TEXTURE1);
     for(int i = 0; i < iterationCount; i++){
-        jacobiShader.use();
-        jacobiShader.uniform1f("alpha", alpha);
-        jacobiShader.uniform1f("beta", beta);
+        shader.use();
+        uniformField(shader, "alpha", type, alpha);
+        uniformField(shader, "beta", type, beta);
         xTexturePair->bindData(GL_TEXTURE0);
 
-        slab->interiorOperation(jacobiShader, xTexturePair, scale);
+        slab->interiorOperation(shader, xTexturePair, scale);
+    }
+}
+
+void SimulationOperations::redBlackIteration(DataTexturePair *xTexturePair, DataTexturePair* bTexturePair,
+                                             int iterationCount, vec3 alpha, vec3 beta, int scale){
+
+    TextureType type = xTexturePair->getType();
+    Shader& shader = type == SCALAR ? scalarRedBlackShader : type == PAIR ? pairRedBlackShader : redBlackShader;
+    bTexturePair->bindData(GL_TEXTURE1);
+    for(int i = 0; i < iterationCount; i++){
+        for(int parity = 0; parity < 2; parity++){
+            shader.use();
+            uniformField(shader, "alpha", type, alpha);
+            uniformField(shader, "beta", type, beta);
+            shader.uniform1f("overRelaxation", overRelaxation);
+            xTexturePair->bindData(GL_TEXTURE0);
+
+            slab->checkerboardOperation(shader, xTexturePair, scale, parity);
+        }
     }
 }
 
@@ -230,4 +355,70 @@ void SimulationOperations::externalForce(DataTexturePair *velocity, GLuint &forc
     bindData(force, GL_TEXTURE1);
 
     slab->fullOperation(externalForceShader, velocity);
-}
\ No newline at end of file
+}
+
+void SimulationOperations::advectWithForces(DataTexturePair* velocity, DataTexturePair* substance, vec3 direction,
+        float buoyancyScale, float windAngle, float windStrength, GLuint force, bool applyForce, float dt) {
+    unsigned stages = 0;
+    if(buoyancyScale != 0.0f)
+        stages |= BUOYANCY;
+    if(windStrength != 0.0f)
+        stages |= WIND;
+    if(applyForce)
+        stages |= EXTERNAL_FORCE;
+
+    // With MacCormack advection, the forces are applied the same way by the semi-lagrangian pass
+    bool macCormack = usesMacCormack(Resolution::velocity);
+    Shader* forward = macCormack ? fusion.advection(stages & ~AFTER_ADVECTION) : nullptr;
+    Shader* shader = fusion.advection(stages, macCormack);
+    if(shader == nullptr || (macCormack && forward == nullptr))
+        return;
+
+    for(Shader* fused : {forward, shader}) {
+        if(fused == nullptr)
+            continue;
+        fused->uniform1f("buoyancy_scale", buoyancyScale);
+        fused->uniform3f("buoyancy_direction", direction);
+        fused->uniform3f("temp_border_width", vec3(1)/vec3(substance->getSize()));
+        fused->uniform1f("wind_angle", windAngle);
+        fused->uniform1f("wind_strength", windStrength);
+    }
+
+    substance->bindData(FUSED_SUBSTANCE_SLOT);
+    if(applyForce)
+        bindData(force, FUSED_FORCE_SLOT);
+    advectForward(velocity, velocity, Resolution::velocity, dt, forward);
+
+    shader->use();
+    advectionUniforms(*shader, velocity, dt);
+    velocity->bindData(GL_TEXTURE0);
+    velocity->bindData(GL_TEXTURE1);
+
+    slab->interiorOperation(*shader, velocity, -1);
+}
+
+void SimulationOperations::advectWithSource(DataTexturePair* velocity, DataTexturePair* substance, GLuint source,
+        SourceMode mode, bool dissipate, float dissipationRate, float dt) {
+    unsigned stages = mode == SourceMode::add ? ADD_SOURCE : SET_SOURCE;
+    if(dissipate)
+        stages |= DISSIPATION;
+
+    // With MacCormack advection, the source is applied the same way by the semi-lagrangian pass
+    bool macCormack = usesMacCormack(Resolution::substance);
+    Shader* forward = macCormack ? fusion.advection(stages & ~AFTER_ADVECTION) : nullptr;
+    Shader* shader = fusion.advection(stages, macCormack);
+    if(shader == nullptr || (macCormack && forward == nullptr))
+        return;
+
+    shader->uniform1f("dissipation_rate", dissipationRate);
+
+    bindData(source, FUSED_SOURCE_SLOT);
+    advectForward(velocity, substance, Resolution::substance, dt, forward);
+
+    shader->use();
+    advectionUniforms(*shader, velocity, dt);
+    velocity->bindData(GL_TEXTURE0);
+    substance->bindData(GL_TEXTURE1);
+
+    slab->fullOperation(*shader, substance);
+}
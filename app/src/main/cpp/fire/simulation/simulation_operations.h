@@ -9,20 +9,48 @@
 #include <fire/settings.h>
 
 #include "slab_operation.h"
+#include "operator_fusion.h"
+#include "multigrid_solver.h"
 #include "fire/util/data_texture_pair.h"
 #include "fire/util/shader.h"
 
+// Iterations of the pressure solve between each measurement of the residual, when solving to a tolerance
+#define PRESSURE_CHECK_INTERVAL 5
+
+// Texture slot of the semi-lagrangian result that is corrected by MacCormack advection
+#define MACCORMACK_FORWARD_SLOT GL_TEXTURE5
+
 class SimulationOperations {
     SlabOperation *slab;
+    OperatorFusion fusion;
+    MultigridSolver multigrid;
 
-    GLuint diffusionBLRTexture, diffusionBHRTexture;
+    DataTexturePair* diffusionBLR;
+    DataTexturePair* diffusionBHR;
     DataTexturePair* divergence;
     DataTexturePair* jacobi;
+    // The semi-lagrangian results of MacCormack advection, for the velocity and the substance
+    // Each is only created once MacCormack advection is first used at its resolution, see advectForward()
+    DataTexturePair* advectionLR = nullptr;
+    DataTexturePair* advectionHR = nullptr;
+
+    // The sizes, scales, layouts and precisions of the fields of the current settings, for the advection fields
+    ivec3 lowResSize, highResSize;
+    float lowScaleFactor, highScaleFactor;
+    FieldLayout lowResLayout, highResLayout;
+    Precision vectorPrecision, scalarPrecision;
 
-    Shader temperatureShader;
     Shader divergenceShader, jacobiShader, gradientShader;
-    Shader addSourceShader, buoyancyShader, advectionShader, externalForceShader;
-    Shader dissipateShader, setSourceShader, windShader;
+    // Specialized for scalar fields, such as the pressure, so that it only computes one channel,
+    // and for pair fields, such as the substance, so that it only computes two
+    Shader scalarJacobiShader, pairJacobiShader;
+    Shader redBlackShader, scalarRedBlackShader, pairRedBlackShader;
+
+    Relaxation relaxation;
+    float overRelaxation;
+    AdvectionScheme velocityAdvection, substanceAdvection;
+    Shader addSourceShader, buoyancyShader, advectionShader, macCormackShader, externalForceShader;
+    Shader substanceDissipationShader, setSourceShader, windShader;
     Shader vorticityShader;
 
 public:
@@ -30,26 +58,26 @@ public:
 
     int changeSettings(Settings* settings, bool shouldRegenFields);
 
-    // Applies buoyancy forces to velocity, based on the temperature
-    void buoyancy(DataTexturePair* velocity, DataTexturePair* temperature, vec3 direction,  float scale, float dt);
+    // Applies buoyancy forces to velocity, based on the temperature of the substance
+    void buoyancy(DataTexturePair* velocity, DataTexturePair* substance, vec3 direction,  float scale, float dt);
 
-    // Performs advection on the given data
+    // Performs advection on the given data, with the advection scheme of its resolution
     // The data and the velocity should use the same resolution for the shader to work correctly
-    void advect(DataTexturePair* velocity, DataTexturePair* data, bool applyVelocityBorder, float dt);
+    void advect(DataTexturePair* velocity, DataTexturePair* data, Resolution res, bool applyVelocityBorder, float dt);
 
-    // Performs heat dissipation on the given temperature field
-    void heatDissipation(DataTexturePair* temperature, float dt);
+    // Dissipates the density of the substance field with the given rate, and performs heat dissipation on its temperature
+    void dissipateSubstance(DataTexturePair* substance, float dissipationRate, float dt);
 
     // Adds the given source field multiplied by dt to the target field
     void addSource(DataTexturePair* data, GLuint source, SourceMode mode, float dt);
 
-    void dissipate(DataTexturePair* data, float dissipationRate, float dt);
+    // Performs diffusion on a texture with given resolution, with a kinematic viscosity for each channel
+    // Channels with a viscosity of 0 are left as they are
+    void diffuse(DataTexturePair* data, Resolution res, int iterationCount, vec3 kinematicViscosity, float dt);
 
-    // Performs diffusion on a texture with given resolution
-    void diffuse(DataTexturePair* data, Resolution res, int iterationCount, float kinematicViscosity, float dt);
-
-    // Projects the given *vector* field
-    void project(DataTexturePair* velocity, int iterationCount);
+    // Projects the given *vector* field, solving for the pressure with the given solver
+    // Starts from the pressure of the previous projection, and stops early once the residual is within the tolerance
+    void project(DataTexturePair* velocity, PressureSolver solver, int iterationCount, float tolerance);
 
     // Apply rotational flows
     void createVorticity(DataTexturePair* velocity, float vorticityScale, float dt);
@@ -58,6 +86,16 @@ public:
 
     void externalForce(DataTexturePair* velocity, GLuint& force, float dt);
 
+    // Performs advection of the velocity followed by buoyancy, wind and the external force in a single pass
+    // Buoyancy and wind are left out if their scale is 0, and the external force if applyForce is false
+    void advectWithForces(DataTexturePair* velocity, DataTexturePair* substance, vec3 direction, float buoyancyScale,
+                          float windAngle, float windStrength, GLuint force, bool applyForce, float dt);
+
+    // Performs advection of the substance followed by adding its source and, if dissipate is true,
+    // the dissipation of dissipateSubstance() in a single pass
+    void advectWithSource(DataTexturePair* velocity, DataTexturePair* substance, GLuint source, SourceMode mode,
+                          bool dissipate, float dissipationRate, float dt);
+
 private:
 
     int initShaders();
@@ -66,9 +104,32 @@ private:
 
     void clearTextures();
 
+    // Sets the uniforms of an advection shader
+    void advectionUniforms(Shader& shader, DataTexturePair* velocity, float dt);
+
+    // Returns whether the resolution uses MacCormack advection
+    bool usesMacCormack(Resolution res);
+
+    // If the resolution uses MacCormack advection, performs the semi-lagrangian advection of the data into
+    // a separate field, which is created the first time, and binds it to MACCORMACK_FORWARD_SLOT for the correction
+    // It is done by the given shader, with any uniforms other than those of advectionUniforms() already set, or by
+    // the plain advection shader if none is given
+    // Returns whether the advection should be finished by a correcting shader
+    bool advectForward(DataTexturePair* velocity, DataTexturePair* data, Resolution res, float dt,
+            Shader* shader = nullptr);
+
+    // Performs a number of iterations with two field inputs, with the relaxation method of the settings
+    // The constants alpha and beta are given for each channel, of which as many are used as the field has
+    void relax(DataTexturePair *xTexturePair, DataTexturePair* bTexturePair,
+               int iterationCount, vec3 alpha, vec3 beta, int scale);
+
     // Performs a number of jacobi iterations with two field inputs
-    void jacobiIteration(DataTexturePair *xTexturePair, GLuint bTexture,
-                         int iterationCount, float alpha, float beta, int scale );
+    void jacobiIteration(DataTexturePair *xTexturePair, DataTexturePair* bTexturePair,
+                         int iterationCount, vec3 alpha, vec3 beta, int scale );
+
+    // Performs a number of red-black gauss-seidel iterations with over-relaxation with two field inputs
+    void redBlackIteration(DataTexturePair *xTexturePair, DataTexturePair* bTexturePair,
+                           int iterationCount, vec3 alpha, vec3 beta, int scale);
 
     // Calculates the divergence of the vector field
     void createDivergence(DataTexturePair* vectorData, float dx);
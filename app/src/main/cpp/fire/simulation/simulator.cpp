@@ -25,15 +25,24 @@
 int Simulator::init(Settings* settings) {
 
     slab = new SlabOperation();
-    if (!slab->init())
+    if (!slab->init(settings))
+        return 0;
+
+    // The wavelet turbulence is initialized first, so that its shaders compile in the background
+    // while the ones needed for the first step are compiled
+    wavelet = new WaveletTurbulence();
+    if(!wavelet->init(slab, settings))
         return 0;
 
     operations = new SimulationOperations();
     if(!operations->init(slab, settings))
         return 0;
 
-    wavelet = new WaveletTurbulence();
-    if(!wavelet->init(slab, settings))
+    activeBricks = new ActiveBricks();
+    if(!activeBricks->init(slab))
+        return 0;
+
+    if(!slab->load(renderProxyShader, "shaders/simulation/slab.vert", "shaders/simulation/render_proxy.frag"))
         return 0;
 
     initData(settings);
@@ -50,6 +59,8 @@ int Simulator::init(Settings* settings) {
     velDiffusionIterations = settings->getVelDiffusionIterations();
     vorticityScale = settings->getVorticityScale();
     projectionIterations = settings->getProjectionIterations();
+    pressureSolver = settings->getPressureSolver();
+    pressureTolerance = settings->getPressureTolerance();
     sourceMode = settings->getSourceMode();
     tempKinematicViscosity = settings->getTempKinematicViscosity();
     tempDiffusionIterations = settings->getTempDiffusionIterations();
@@ -61,6 +72,8 @@ int Simulator::init(Settings* settings) {
 
     orientationMode = settings->getOrientationMode();
 
+    operatorFusion = settings->getOperatorFusion();
+
     start_time = NOW;
     last_time = start_time;
 
@@ -86,6 +99,8 @@ int Simulator::changeSettings(Settings* settings, bool shouldRegenFields) {
     velDiffusionIterations = settings->getVelDiffusionIterations();
     vorticityScale = settings->getVorticityScale();
     projectionIterations = settings->getProjectionIterations();
+    pressureSolver = settings->getPressureSolver();
+    pressureTolerance = settings->getPressureTolerance();
     sourceMode = settings->getSourceMode();
     tempKinematicViscosity = settings->getTempKinematicViscosity();
     tempDiffusionIterations = settings->getTempDiffusionIterations();
@@ -97,6 +112,8 @@ int Simulator::changeSettings(Settings* settings, bool shouldRegenFields) {
 
     orientationMode = settings->getOrientationMode();
 
+    operatorFusion = settings->getOperatorFusion();
+
     if(shouldRegenFields) {
         //clearData();
         initData(settings);
@@ -105,7 +122,7 @@ int Simulator::changeSettings(Settings* settings, bool shouldRegenFields) {
     return operations->changeSettings(settings, shouldRegenFields) && wavelet->changeSettings(settings, shouldRegenFields);
 }
 
-void Simulator::update(GLuint& densityData, GLuint& temperatureData, ivec3& size) {
+void Simulator::update(GLuint& substanceData, ivec3& size) {
     // todo maybe put a cap on the delta time to not get too big time steps during lag?
     float current_time = DURATION(NOW, start_time);
     float delta_time = DURATION(NOW, last_time);
@@ -117,20 +134,41 @@ void Simulator::update(GLuint& densityData, GLuint& temperatureData, ivec3& size
 
     velocityStep(delta_time);
 
-    smokeDensityStep(delta_time);
+    // The substance is only updated in the bricks around the fire, once they have been measured
+    if(activeBricks->step())
+        slab->restrictOperations(substance->getSize(), activeBricks->getRegions());
+
+    substanceStep(delta_time);
 
-    temperatureStep(delta_time);
+    if(renderProxy != nullptr)
+        updateRenderProxy();
+    else if(substance->isFlat())
+        slab->copy(substance, substanceVolume);
+
+    slab->unrestrictOperations();
+    activeBricks->measure(substance, higherVelocity, substanceSource);
 
     slab->finish();
 
-    getData(densityData, temperatureData, size);
+    getData(substanceData, size);
+
+}
+
+void Simulator::updateRenderProxy() {
+    renderProxyShader.use();
+    renderProxyShader.uniform2f("temperatureRange", renderProxyTemperatures);
+    substance->bindData(GL_TEXTURE0);
 
+    slab->fullOperation(renderProxyShader, renderProxy);
 }
 
-void Simulator::getData(GLuint& densityData, GLuint& temperatureData, ivec3& size) {
-    temperatureData = temperature->getDataTexture();
-    densityData = smokeDensity->getDataTexture();
-    ivec3 highResSize = temperature->getSize();
+void Simulator::getData(GLuint& substanceData, ivec3& size) {
+    if(renderProxy != nullptr)
+        substanceData = renderProxy->getDataTexture();
+    else if(substance->isFlat())
+        substanceData = substanceVolume->getDataTexture();
+    else substanceData = substance->getDataTexture();
+    ivec3 highResSize = substance->getSize();
 
     size = highResSize;
 }
@@ -178,61 +216,97 @@ void Simulator::initData(Settings* settings) {
     initSourceField(temperature_source, settings->getSourceTemperature(), Resolution::substance, settings);
     initSourceField(velocity_source, settings->getSourceVelocity(), Resolution::velocity, settings);
 
-    smokeDensity = createScalarDataPair(density_field, highResSize, highScaleFactor);
-    createScalar3DTexture(densitySource, highResSize, density_source);
+    FieldLayout lowResLayout = slab->fieldLayout(settings, Resolution::velocity);
+    FieldLayout highResLayout = slab->fieldLayout(settings, Resolution::substance);
+
+    Precision vectorPrecision = settings->getFieldPrecision(FieldKind::vectors);
+    Precision scalarPrecision = settings->getFieldPrecision(FieldKind::scalars);
+
+    vec2* substance_field = createPairField(density_field, temperature_field, highResSize);
+    vec2* substance_source = createPairField(density_source, temperature_source, highResSize);
 
-    temperature = createScalarDataPair(temperature_field, highResSize, highScaleFactor);
-    createScalar3DTexture(temperatureSource, highResSize, temperature_source);
+    substance = createPairDataPair(substance_field, highResSize, highScaleFactor, highResLayout, scalarPrecision);
+    createPair3DTexture(substanceSource, highResSize, substance_source);
 
-    lowerVelocity = createVectorDataPair(velocity_field, lowResSize, lowScaleFactor);
-    higherVelocity = createVectorDataPair(nullptr, highResSize, highScaleFactor);
+    renderProxyTemperatures = settings->getRenderProxyTemperatures();
+    renderProxy = nullptr;
+    if(settings->getRenderProxy()) {
+        // The renderer samples the substance as a 3D texture, which the copy is even if the substance is flat
+        renderProxy = createPairDataPair(nullptr, highResSize, highScaleFactor, FieldLayout::volume, Precision::unorm8);
+    } else if(highResLayout == FieldLayout::flat) {
+        // The renderer samples the substance as a 3D texture
+        substanceVolume = createPairDataPair(substance_field, highResSize, highScaleFactor, FieldLayout::volume,
+                scalarPrecision);
+    }
+
+    lowerVelocity = createVectorDataPair(velocity_field, lowResSize, lowScaleFactor, lowResLayout, vectorPrecision);
+    higherVelocity = createVectorDataPair(nullptr, highResSize, highScaleFactor, highResLayout, vectorPrecision);
     createVector3DTexture(velocitySource, lowResSize, velocity_source);
 
     force_field = createVectorField(vec3(0.0f, 0.0f,0.0f), lowResSize);
 
+    if(settings->getActiveBricks())
+        activeBricks->initTextures(highResSize, settings->getActiveBrickThresholds());
+    else activeBricks->clearTextures();
+
     delete[] density_field;
     delete[] density_source;
     delete[] temperature_field;
     delete[] temperature_source;
+    delete[] substance_field;
+    delete[] substance_source;
     delete[] velocity_field;
     delete[] velocity_source;
 }
 
 void Simulator::clearData() {
-    delete smokeDensity;
-    delete temperature;
+    if(renderProxy != nullptr)
+        delete renderProxy;
+    else if(substance->isFlat())
+        delete substanceVolume;
+    renderProxy = nullptr;
+    delete substance;
     delete lowerVelocity;
     delete higherVelocity;
-    glDeleteTextures(1, &densitySource);
-    glDeleteTextures(1, &temperatureSource);
+    glDeleteTextures(1, &substanceSource);
     glDeleteTextures(1, &velocitySource);
 }
 
 
 
 void Simulator::velocityStep(float delta_time){
-    // Source
-    if(buoyancyScale != 0.0f)
-        operations->buoyancy(lowerVelocity, temperature, buoyancy_direction, buoyancyScale, delta_time);
-
-    if(windScale != 0.0f)
-        updateAndApplyWind(windScale, delta_time);
+    if(operatorFusion) {
+        // Apply the forces in the same pass as the advection
+        if(windScale != 0.0f)
+            updateWindAngle(delta_time);
+        operations->advectWithForces(lowerVelocity, substance, buoyancy_direction, buoyancyScale,
+                PI * windAngle / 180.0f, windScale, force, externalForceReady, delta_time);
+    } else {
+        // Source
+        if(buoyancyScale != 0.0f)
+            operations->buoyancy(lowerVelocity, substance, buoyancy_direction, buoyancyScale, delta_time);
+
+        if(windScale != 0.0f)
+            updateAndApplyWind(windScale, delta_time);
+
+        if(externalForceReady)
+            operations->externalForce(lowerVelocity, force, delta_time);
+
+        // Advect
+        operations->advect(lowerVelocity, lowerVelocity, Resolution::velocity, true, delta_time);
+    }
 
     if(externalForceReady){
-        operations->externalForce(lowerVelocity, force, delta_time);
         delete[] force_field;
         ivec3 lowResSize = lowerVelocity->getSize();
         force_field = createVectorField(vec3(0.0f, 0.0f,0.0f), lowResSize);
         externalForceReady = false;
     }
 
-    // Advect
-    operations->advect(lowerVelocity, lowerVelocity, true, delta_time);
-
     // Diffuse
     if(velKinematicViscosity != 0.0f)
         operations->diffuse(lowerVelocity, Resolution::velocity,
-                velDiffusionIterations, velKinematicViscosity, delta_time);
+                velDiffusionIterations, vec3(velKinematicViscosity), delta_time);
 
     // Vorticity
     if(vorticityScale != 0.0f)
@@ -240,53 +314,62 @@ void Simulator::velocityStep(float delta_time){
   
     // Project
     if(projectionIterations != 0)
-        operations->project(lowerVelocity, projectionIterations);
+        operations->project(lowerVelocity, pressureSolver, projectionIterations, pressureTolerance);
 
     // Go from low-res velocity to high-res velocity using Wavelet
     wavelet->waveletStep(lowerVelocity, higherVelocity, delta_time);
 }
 
 void Simulator::updateAndApplyWind(float scale, float delta_time) {
-    if(rotatingWindAngle)
-        windAngle += 90.0*delta_time;
+    updateWindAngle(delta_time);
 
     float windStrength = scale;
     operations->addWind(lowerVelocity, PI * windAngle / 180.0f, windStrength, delta_time);
 }
 
-void Simulator::temperatureStep(float delta_time) {
-    // Force
-    operations->addSource(temperature, temperatureSource, sourceMode, delta_time);
-
-    // Advection
-    operations->advect(higherVelocity, temperature, false, delta_time);
+void Simulator::updateWindAngle(float delta_time) {
+    if(rotatingWindAngle)
+        windAngle += 90.0*delta_time;
+}
 
-    // Diffusion
+void Simulator::substanceStep(float delta_time) {
+    // The density and temperature are diffused by the same solve, with the iterations of the one that needs most
+    vec3 kinematicViscosity = vec3(smokeKinematicViscosity, tempKinematicViscosity, 0.0f);
+    int diffusionIterations = 0;
+    if(smokeKinematicViscosity != 0.0f)
+        diffusionIterations = smokeDiffusionIterations;
     if(tempKinematicViscosity != 0.0f)
-        operations->diffuse(temperature, Resolution::substance,
-                            tempDiffusionIterations, tempKinematicViscosity, delta_time);
+        diffusionIterations = max(diffusionIterations, tempDiffusionIterations);
 
-    // Dissipation
-    operations->heatDissipation(temperature, delta_time);
+    if(operatorFusion) {
+        // Heat dissipation can only be moved before diffusion when the temperature isn't diffused,
+        // while the dissipation of the density is linear, so it gives the same result before diffusion
+        bool fuseDissipation = tempKinematicViscosity == 0.0f;
+        operations->advectWithSource(higherVelocity, substance, substanceSource, sourceMode,
+                fuseDissipation, smokeDissipation, delta_time);
 
-}
+        if(diffusionIterations != 0)
+            operations->diffuse(substance, Resolution::substance,
+                    diffusionIterations, kinematicViscosity, delta_time);
 
-void Simulator::smokeDensityStep(float delta_time) {
+        if(!fuseDissipation)
+            operations->dissipateSubstance(substance, smokeDissipation, delta_time);
+        return;
+    }
 
-    // addForce
-    operations->addSource(smokeDensity, densitySource, sourceMode, delta_time);
+    // Source
+    operations->addSource(substance, substanceSource, sourceMode, delta_time);
 
-    // Advect
-    operations->advect(higherVelocity, smokeDensity, false, delta_time);
+    // Advection
+    operations->advect(higherVelocity, substance, Resolution::substance, false, delta_time);
 
-    // Diffuse
-    if(smokeKinematicViscosity != 0.0f)
-        operations->diffuse(smokeDensity, Resolution::substance,
-                smokeDiffusionIterations, smokeKinematicViscosity, delta_time);
+    // Diffusion
+    if(diffusionIterations != 0)
+        operations->diffuse(substance, Resolution::substance,
+                diffusionIterations, kinematicViscosity, delta_time);
 
-    // Dissipate
-    if(smokeDissipation != 0.0f)
-        operations->dissipate(smokeDensity, smokeDissipation, delta_time);
+    // Dissipation
+    operations->dissipateSubstance(substance, smokeDissipation, delta_time);
 
 }
 
@@ -12,6 +12,7 @@
 
 #include "simulation_operations.h"
 #include "wavelet_turbulence.h"
+#include "active_bricks.h"
 
 using std::chrono::time_point;
 using std::chrono::system_clock;
@@ -20,14 +21,23 @@ class Simulator {
     SlabOperation* slab;
     SimulationOperations* operations;
     WaveletTurbulence* wavelet;
+    ActiveBricks* activeBricks;
 
-    DataTexturePair* smokeDensity;
-    DataTexturePair* temperature;
+    // The density and temperature of the smoke, in the first and second channel
+    DataTexturePair* substance;
     DataTexturePair* lowerVelocity;
     DataTexturePair* higherVelocity;
 
+    // Volume copy of a flat substance field, for the renderer
+    DataTexturePair* substanceVolume;
+
+    // 8 bit copy of the substance for the renderer, with the temperature mapped from the range, or null if not used
+    DataTexturePair* renderProxy = nullptr;
+    vec2 renderProxyTemperatures;
+    Shader renderProxyShader;
+
     //Textures for sources
-    GLuint densitySource, temperatureSource, velocitySource;
+    GLuint substanceSource, velocitySource;
 
     //External force
     GLuint force;
@@ -47,6 +57,8 @@ class Simulator {
     float vorticityScale;
 
     int projectionIterations;
+    PressureSolver pressureSolver;
+    float pressureTolerance;
 
     SourceMode sourceMode;
 
@@ -64,6 +76,8 @@ class Simulator {
 
     bool orientationMode;
 
+    bool operatorFusion;
+
     float rotation;
 
     // Time
@@ -75,7 +89,9 @@ public:
 
     int changeSettings(Settings* settings, bool shouldRegenFields);
 
-    void update(GLuint& densityData, GLuint& temperatureData, ivec3& size);
+    // Performs a simulation step, and returns the substance texture with the density and temperature in its
+    // first and second channel, and its size
+    void update(GLuint& substanceData, ivec3& size);
 
     void addExternalForce(vec3 position, vec3 vector, Settings* settings);
 
@@ -89,16 +105,20 @@ private:
 
     void clearData();
 
-    void getData(GLuint& densityData, GLuint& temperatureData, ivec3& size);
+    void getData(GLuint& substanceData, ivec3& size);
+
+    // Copies the substance to the 8 bit render proxy
+    void updateRenderProxy();
 
     // Performs one fire.simulation step for velocity
     void velocityStep(float delta_time);
 
     void updateAndApplyWind(float scale, float delta_time);
 
-    void temperatureStep( float delta_time);
+    void updateWindAngle(float delta_time);
 
-    void smokeDensityStep(float delta_time);
+    // Performs one fire.simulation step for the density and temperature together
+    void substanceStep(float delta_time);
 };
 
 #endif //DATX02_20_21_SIMULATOR_H
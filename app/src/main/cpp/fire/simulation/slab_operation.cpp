@@ -6,19 +6,25 @@
 #include <jni.h>
 #include <time.h>
 #include <math.h>
+#include <stdlib.h>
 #include <string>
+#include <regex>
+#include <algorithm>
+#include <vector>
 
 #include <GLES3/gl31.h>
 #include <GLES3/gl3ext.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <android/asset_manager.h>
 #include <android/asset_manager_jni.h>
 #include <android/log.h>
 
 #include "fire/util/helper.h"
+#include "fire/util/shader_preprocessor.h"
 
 #define LOG_TAG "Slab operation"
 #define LOG_ERROR(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
@@ -28,18 +34,24 @@ using namespace glm;
 
 #define PI 3.14159265359f
 
-int SlabOperation::init() {
+int SlabOperation::init(Settings* settings) {
 
     glDisable(GL_DEPTH_TEST);
     glDisable(GL_CULL_FACE);
 
+    useCompute = settings->getSlabBackend() == SlabBackend::compute;
+    // The compute backend stores scalar fields as R32F, which still has to be filtered and rendered to
+    if(useCompute && !(hasExtension("GL_OES_texture_float_linear") && hasExtension("GL_EXT_color_buffer_float"))) {
+        LOG_INFO("Float textures are not fully supported, falling back to the fragment slab backend");
+        useCompute = false;
+    }
+    setImageTextureStorage(useCompute);
+
     FBO = new SimpleFramebuffer();
     FBO->init();
 
     initQuad();
 
-    initLine();
-
     if(!initShaders()) {
         LOG_ERROR("Failed to compile slab_operation shaders");
         return 0;
@@ -56,43 +68,6 @@ void SlabOperation::boundaryMode(BoundaryType mode){
         doBoundary = true;
 }
 
-void SlabOperation::initLine() {
-    glGenVertexArrays(1, &boundaryVAO);
-    // Bind the vertex array object
-    // The following calls will affect this vertex array object.
-    glBindVertexArray(boundaryVAO);
-
-    ///////////////////////////////////
-    // Define the positions
-    const float positions[] = {
-            // X      Y       Z
-            -1.0f, -1.0f, 0.0f,  // v0
-            -1.0f,  1.0f, 0.0f, // v1
-             1.0f,  1.0f, 0.0f, // v2
-             1.0f, -1.0f, 0.0f   // v3
-    };
-
-    // Create a handle for the position vertex buffer object
-    glGenBuffers(1, &boundaryPositionBuffer);
-    // Set the newly created buffer as the current one
-    glBindBuffer(GL_ARRAY_BUFFER, boundaryPositionBuffer);
-    // Send the vertex position data to the current buffer
-    glBufferData(GL_ARRAY_BUFFER, sizeof(positions), positions, GL_STATIC_DRAW);
-    // Attaches positionBuffer to vertexArrayObject, in the 0th attribute location
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE /*normalized*/, 0 /*stride*/, 0 /*offset*/);
-    // Enable the vertex position attribute
-    glEnableVertexAttribArray(0);
-
-    const GLuint indices[] = {
-            0, 1, // Line 1
-            2, 3, // Line 2
-    };
-
-    glGenBuffers(1, &interiorIndexBuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, interiorIndexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-}
-
 void SlabOperation::initQuad() {
 
     glGenVertexArrays(1, &interiorVAO);
@@ -152,66 +127,272 @@ void SlabOperation::initQuad() {
 
 }
 
-int SlabOperation::initShaders() {
-    bool success = true;
-    // Boundaries
-    success &= boundaryShader.load("shaders/simulation/slab.vert", "shaders/simulation/boundary.frag");
-    success &= FABInteriorShader.load("shaders/simulation/slab.vert", "shaders/simulation/front_and_back_interior.frag");
-    success &= FABBoundaryShader.load("shaders/simulation/slab.vert", "shaders/simulation/front_and_back_boundary.frag");
-    // Utilities
-    success &= copyShader.load("shaders/simulation/slab.vert", "shaders/simulation/copy.frag");
-    return success;
+static void replaceAll(std::string& source, const std::string& from, const std::string& to) {
+    for(size_t i = source.find(from); i != std::string::npos; i = source.find(from, i + to.size()))
+        source.replace(i, from.size(), to);
 }
 
-void SlabOperation::setBoundary(DataTexturePair* data, int scale) {
-    // Input data used in all steps
-    data->bindData(GL_TEXTURE0);
-    ivec3 gridSize = data->getSize();
-    boundaryShader.use();
-    boundaryShader.uniform3f("gridSize", gridSize);
-    boundaryShader.uniform1f("scale", scale);
+// Replaces the main function, gl_FragCoord and the depth uniform of a slab fragment shader,
+// so that a new main function can set them up before calling slab_main()
+static void replaceEntryPoint(std::string& source) {
+    replaceAll(source, "uniform int depth;", "");
+    replaceAll(source, "gl_FragCoord", "slab_FragCoord");
+    replaceAll(source, "void main()", "void slab_main()");
+}
 
-    //Apply boundary operation
-    for(int depth = 1; depth < gridSize.z - 1; depth++){
-        data->bindToFramebuffer(depth);
+static const char* imageFormat(TextureType type) {
+    return type == SCALAR ? "r32f" : "rgba16f";
+}
 
-        if(!drawLayerBoundary(boundaryShader, depth, gridSize))
-            return;
-    }
+// Generates a compute shader that performs the same operation as a slab fragment shader, for one depth layer per
+// z-coordinate of the dispatch. The fragment shader is kept as is, except that its main function, output,
+// gl_FragCoord and depth uniform are replaced with globals that are set up by a new main function.
+// The output is stored through overloads for every output type, since the type may be a macro of the shader.
+// An in place variant of a checkerboard operation reads and writes the data texture of a scalar field, and only
+// runs the cells of the parity, which is safe since they only read cells of the other parity.
+// Returns an empty string if the fragment shader has no output.
+static std::string fragmentToCompute(std::string source, TextureType type, bool inPlace) {
+    size_t out = source.find("\nout ");
+    if(out == std::string::npos)
+        return "";
+
+    size_t typeEnd = source.find(' ', out + 5);
+    std::string outName = source.substr(typeEnd + 1, source.find(';', typeEnd) - typeEnd - 1);
+    source.erase(out + 1, 4);
+
+    replaceEntryPoint(source);
+
+    std::string image = inPlace
+            ? "layout(r32f, binding = 0) uniform highp image3D slab_result;\n"
+              "uniform int slab_parity;\n"
+            : "layout(" + std::string(imageFormat(type)) + ", binding = 0) writeonly uniform highp image3D slab_result;\n";
+
+    std::string groupSize = std::to_string(SLAB_GROUP_SIZE);
+    source = injectAfterVersion(source,
+            "layout(local_size_x = " + groupSize + ", local_size_y = " + groupSize + ", local_size_z = " + groupSize + ") in;\n"
+            + image +
+            "uniform ivec3 slab_offset;\n"
+            "uniform ivec3 slab_end;\n"
+            "vec4 slab_FragCoord;\n"
+            "int depth;\n"
+            "vec4 slab_output(float value) { return vec4(value, 0.0, 0.0, 0.0); }\n"
+            "vec4 slab_output(vec2 value) { return vec4(value, 0.0, 0.0); }\n"
+            "vec4 slab_output(vec3 value) { return vec4(value, 0.0); }\n"
+            "vec4 slab_output(vec4 value) { return value; }\n");
+
+    std::string position = inPlace
+            ? "    ivec3 position = slab_offset + ivec3(2 * int(gl_GlobalInvocationID.x), gl_GlobalInvocationID.yz);\n"
+              "    position.x += (position.x + position.y + position.z + slab_parity) & 1;\n"
+            : "    ivec3 position = slab_offset + ivec3(gl_GlobalInvocationID);\n";
+    source += "\n"
+            "void main() {\n"
+            + position +
+            "    if (any(greaterThanEqual(position, slab_end)))\n"
+            "        return;\n"
+            "    slab_FragCoord = vec4(vec2(position.xy) + vec2(0.5), 0.5, 1.0);\n"
+            "    depth = position.z;\n"
+            "    slab_main();\n"
+            "    imageStore(slab_result, position, slab_output(" + outName + "));\n"
+            "}\n";
+    return source;
+}
 
-    //Copy over the inside
-    copyShader.use();
-    for(int depth = 1; depth < gridSize.z - 1; depth++){
-        data->bindToFramebuffer(depth);
+static const std::regex samplerDeclaration(
+        "layout\\s*\\(\\s*binding\\s*=\\s*(\\d+)\\s*\\)\\s*uniform\\s+(?:highp\\s+)?sampler3D\\s+(\\w+)\\s*;");
+
+// Texture functions for samplers of fields in the flat layout, which take the tiling of the field
+// (its size and the number of tiles per row) after the sampler
+static std::string flatSamplingFunctions() {
+    return "uniform highp ivec4 slab_tiling[" + std::to_string(TILED_TEXTURE_UNITS) + "];\n"
+            "\n"
+            "ivec2 slab_tile(ivec4 tiling, int z) {\n"
+            "    return tiling.xy * ivec2(z % tiling.w, z / tiling.w);\n"
+            "}\n"
+            "\n"
+            "vec4 slab_texelFetch(highp sampler2D field, ivec4 tiling, ivec3 position, int lod) {\n"
+            "    position = clamp(position, ivec3(0), tiling.xyz - 1);\n"
+            "    return texelFetch(field, slab_tile(tiling, position.z) + position.xy, lod);\n"
+            "}\n"
+            "\n"
+            "// Filters bilinearly within the two closest slices and linearly between them, clamped to the edges like a volume\n"
+            "vec4 slab_texture(highp sampler2D field, ivec4 tiling, vec3 position) {\n"
+            "    vec3 texel = clamp(position * vec3(tiling.xyz), vec3(0.5), vec3(tiling.xyz) - 0.5) - 0.5;\n"
+            "    int z = int(texel.z);\n"
+            "    vec2 atlasSize = vec2(textureSize(field, 0));\n"
+            "    vec2 front = (vec2(slab_tile(tiling, z)) + texel.xy + 0.5) / atlasSize;\n"
+            "    vec2 back = (vec2(slab_tile(tiling, min(z + 1, tiling.z - 1))) + texel.xy + 0.5) / atlasSize;\n"
+            "    return mix(texture(field, front), texture(field, back), texel.z - float(z));\n"
+            "}\n"
+            "\n"
+            "ivec3 slab_textureSize(highp sampler2D field, ivec4 tiling, int lod) {\n"
+            "    return tiling.xyz;\n"
+            "}\n"
+            "\n";
+}
 
-        if(!drawLayerInterior(copyShader, depth, gridSize))
-            return;
+// Returns a bit mask of the texture units that the shader declares 3D samplers for
+static unsigned samplerUnits(const std::string& source) {
+    unsigned units = 0;
+    for(std::sregex_iterator it(source.begin(), source.end(), samplerDeclaration), end; it != end; ++it)
+        units |= 1u << atoi((*it)[1].str().c_str());
+    return units;
+}
+
+// Generates a variant of a slab fragment shader for fields in the flat layout.
+// The samplers of the flat texture units become 2D samplers that are read through the flat sampling functions.
+// With a flat result, every tile of the field is drawn at once, so the new main function works out the cell from
+// gl_FragCoord and discards cells outside of the operation.
+static std::string fragmentToFlat(const std::string& source, unsigned flatUnits, bool flatResult) {
+    std::string result;
+    std::vector<std::pair<std::string, std::string>> samplers;
+
+    size_t last = 0;
+    for(std::sregex_iterator it(source.begin(), source.end(), samplerDeclaration), end; it != end; ++it) {
+        const std::smatch& match = *it;
+        result += source.substr(last, match.position() - last);
+        last = match.position() + match.length();
+
+        if(!(flatUnits >> atoi(match[1].str().c_str()) & 1u)) {
+            result += match.str();
+            continue;
+        }
+        if(samplers.empty())
+            result += flatSamplingFunctions();
+        result += "layout(binding = " + match[1].str() + ") uniform highp sampler2D " + match[2].str() + ";";
+        samplers.push_back(std::make_pair(match[2].str(), match[1].str()));
+    }
+    result += source.substr(last);
+
+    for(auto& sampler : samplers) {
+        std::string arguments = "(" + sampler.first + ", slab_tiling[" + sampler.second + "], ";
+        const char* functions[] = {"texelFetch", "textureSize", "texture"};
+        for(const char* function : functions) {
+            std::regex call(std::string("\\b") + function + "\\s*\\(\\s*" + sampler.first + "\\s*,\\s*");
+            result = std::regex_replace(result, call, std::string("slab_") + function + arguments);
+        }
     }
 
-    // Front
-    if(!drawFrontOrBackBoundary(data, scale, 0))
-        return;
+    if(!flatResult)
+        return result;
+
+    replaceEntryPoint(result);
+    result = injectAfterVersion(result,
+            "uniform highp ivec3 slab_offset;\n"
+            "uniform highp ivec3 slab_end;\n"
+            "uniform highp ivec4 slab_target;\n"
+            "highp vec4 slab_FragCoord;\n"
+            "highp int depth;\n");
+
+    result += "\n"
+            "void main() {\n"
+            "    ivec2 atlasPosition = ivec2(gl_FragCoord.xy);\n"
+            "    ivec2 tile = atlasPosition / slab_target.xy;\n"
+            "    ivec3 position = ivec3(atlasPosition - tile * slab_target.xy, tile.y * slab_target.w + tile.x);\n"
+            "    if (any(lessThan(position, slab_offset)) || any(greaterThanEqual(position, slab_end)))\n"
+            "        discard;\n"
+            "    slab_FragCoord = vec4(vec2(position.xy) + vec2(0.5), gl_FragCoord.zw);\n"
+            "    depth = position.z;\n"
+            "    slab_main();\n"
+            "}\n";
+    return result;
+}
 
-    //Back
-    if(!drawFrontOrBackBoundary(data, scale, gridSize.z - 1))
-        return;
+// Generates a variant of a slab fragment shader that also computes the boundary of the field, so that boundary
+// conditions don't need passes of their own. A boundary cell evaluates the operation at the closest interior cell
+// and scales the result by the boundary scale, which reflects (scale -1) or copies (scale 1) the interior like a ghost
+// cell. Edges and corners average the faces next to them, which all mirror that same interior cell, so they are
+// scaled once as well. The result is again a slab fragment shader, so the other variants can be
+// generated from it, which is why the names of the original are prefixed instead of reusing the slab_ ones.
+static std::string fragmentToGhost(std::string source) {
+    size_t out = source.find("\nout ");
+    if(out == std::string::npos)
+        return "";
+    size_t typeEnd = source.find(' ', out + 5);
+    std::string outName = source.substr(typeEnd + 1, source.find(';', typeEnd) - typeEnd - 1);
+
+    replaceAll(source, "uniform int depth;", "");
+    source = std::regex_replace(source, std::regex("\\bdepth\\b"), "ghost_depth");
+    replaceAll(source, "gl_FragCoord", "ghost_FragCoord");
+    replaceAll(source, "void main()", "void ghost_main()");
+
+    source = injectAfterVersion(source,
+            "uniform int depth;\n"
+            "uniform highp ivec3 slab_size;\n"
+            "uniform highp float slab_boundaryScale;\n"
+            "highp vec4 ghost_FragCoord;\n"
+            "highp int ghost_depth;\n");
+
+    source += "\n"
+            "void main() {\n"
+            "    ivec3 position = ivec3(ivec2(gl_FragCoord.xy), depth);\n"
+            "    ivec3 interior = clamp(position, ivec3(1), slab_size - 2);\n"
+            "    float ghost_scale = any(notEqual(position, interior)) ? slab_boundaryScale : 1.0;\n"
+            "    ghost_FragCoord = vec4(vec2(interior.xy) + vec2(0.5), gl_FragCoord.zw);\n"
+            "    ghost_depth = interior.z;\n"
+            "    ghost_main();\n"
+            "    " + outName + " *= ghost_scale;\n"
+            "}\n";
+    return source;
+}
 
-    data->operationFinished();
+// Variants are indexed by the options they were generated with. The shader itself has index 0,
+// which is the fragment shader as it was loaded.
+static int variantIndex(bool ghost, bool compute, TextureType type, unsigned flatUnits, bool flatResult,
+        bool inPlace) {
+    return (ghost ? 1 : 0) | (compute ? 2 : 0) | (compute && type != SCALAR ? 4 : 0) | (flatResult ? 8 : 0)
+            | (inPlace ? 16 : 0) | flatUnits << 5;
 }
 
-bool SlabOperation::drawFrontOrBackBoundary(DataTexturePair* data, int scale, int depth){
-    data->bindToFramebuffer(depth);
+int SlabOperation::load(Shader& shader, const char* vertex_path, const char* fragment_path,
+        const ShaderDefines& defines) {
+    return loadSource(shader, vertex_path, loadShaderSource(fragment_path, defines), fragment_path);
+}
 
-    ivec3 gridSize = data->getSize();
-    FABBoundaryShader.use();
-    FABBoundaryShader.uniform3f("gridSize", gridSize);
-    FABBoundaryShader.uniform1f("scale", scale);
-    if(!drawLayerBoundary(FABBoundaryShader, depth, gridSize))
-        return false;
+int SlabOperation::loadAsync(Shader& shader, const char* vertex_path, const char* fragment_path,
+        const ShaderDefines& defines) {
+    return loadSource(shader, vertex_path, loadShaderSource(fragment_path, defines), fragment_path, true);
+}
+
+int SlabOperation::loadSource(Shader& shader, const char* vertex_path, const std::string& fragment, const char* name,
+        bool async) {
+    if(async ? !shader.loadFragmentSourceAsync(vertex_path, fragment, name)
+             : !shader.loadFragmentSource(vertex_path, fragment, name))
+        return 0;
+
+    SlabShaderSource source = {vertex_path, name, fragment, samplerUnits(fragment), async};
+    sources[shader.program()] = source;
+    return 1;
+}
+
+int SlabOperation::initShaders() {
+    bool success = true;
+    // Utilities
+    success &= load(copyShader, "shaders/simulation/slab.vert", "shaders/simulation/copy.frag");
+    std::string restrictionCopy = loadShaderSource("shaders/simulation/copy.frag");
+    replaceAll(restrictionCopy, "binding = 0", "binding = " + std::to_string(RESTRICTION_SOURCE_SLOT - GL_TEXTURE0));
+    success &= loadSource(restrictionCopyShader, "shaders/simulation/slab.vert", restrictionCopy,
+            "shaders/simulation/copy.frag (restricted)");
+    return success;
+}
+
+FieldLayout SlabOperation::fieldLayout(Settings* settings, Resolution res) {
+    if(settings->getFieldLayout(res) == FieldLayout::volume)
+        return FieldLayout::volume;
 
-    FABInteriorShader.use();
-    FABInteriorShader.uniform1f("scale", scale);
-    return drawLayerInterior(FABInteriorShader, depth, gridSize);
+    if(useCompute) {
+        LOG_INFO("The compute slab backend does not support flat fields, using volumes instead");
+        return FieldLayout::volume;
+    }
+
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    ivec3 size = settings->getSize(res);
+    ivec2 flatSize = ivec2(size) * flatTextureTiles(size);
+    if(flatSize.x > maxSize || flatSize.y > maxSize) {
+        LOG_INFO("Fields of size %d, %d, %d are too large to be flat, using volumes instead", size.x, size.y, size.z);
+        return FieldLayout::volume;
+    }
+    return FieldLayout::flat;
 }
 
 void SlabOperation::prepare() {
@@ -228,80 +409,307 @@ void SlabOperation::finish() {
     FBO->unbind();
 }
 
-void SlabOperation::interiorOperation(Shader shader, DataTexturePair* data, int boundaryScale) {
+void SlabOperation::interiorOperation(Shader& shader, DataTexturePair* data, int boundaryScale) {
     ivec3 size = data->getSize();
-    for(int depth = 1; depth < size.z - 1; depth++) {
-
-        data->bindToFramebuffer(depth);
-        if(!drawLayerInterior(shader, depth, size))
-            return;
+    GLuint program = doBoundary ? useProgram(shader, data, true) : 0;
+    if(program == 0) {
+        operation(shader, data, false, ivec3(1), size - 1);
+        return;
     }
-    data->operationFinished();
 
-    if(doBoundary)
-        setBoundary(data, boundaryScale);
+    SlabUniforms uniforms = slabUniforms(shader, program);
+    glUniform3i(uniforms.size, size.x, size.y, size.z);
+    glUniform1f(uniforms.boundaryScale, boundaryScale);
+    operation(shader, data, true, ivec3(0), size);
 }
 
-void SlabOperation::fullOperation(Shader shader, DataTexturePair* data) {
+void SlabOperation::checkerboardOperation(Shader& shader, DataTexturePair* data, int boundaryScale, int parity) {
+    shader.uniform1i("parity", parity);
+    if(!computes(data) || data->getType() != SCALAR) {
+        interiorOperation(shader, data, boundaryScale);
+        return;
+    }
+
+    copyOutsideRegions(data);
     ivec3 size = data->getSize();
-    for(int depth = 0; depth < size.z; depth++) {
+    bool ghost = doBoundary && useProgram(shader, data, true, true) != 0;
+    GLuint program = useProgram(shader, data, ghost, true);
+    if(program == 0)
+        return;
+    SlabUniforms uniforms = slabUniforms(shader, program);
+    if(ghost) {
+        glUniform3i(uniforms.size, size.x, size.y, size.z);
+        glUniform1f(uniforms.boundaryScale, boundaryScale);
+    }
+    glUniform1i(uniforms.parity, parity);
+    shader.bindUniformBlocks();
 
-        data->bindToFramebuffer(depth);
-        if(!drawLayer(shader, depth, size))
+    // The data texture is both sampled and written, so the pair is not swapped
+    data->bindDataToImage(0);
+    for(SlabRegion& region : operationRegions(data, ghost ? ivec3(0) : ivec3(1), ghost ? size : size - 1)) {
+        if(!dispatch(program, uniforms, region.offset, region.end, true))
             return;
     }
-    data->operationFinished();
 }
 
-void SlabOperation::copy(DataTexturePair *source, GLuint target) {
+void SlabOperation::fullOperation(Shader& shader, DataTexturePair* data) {
+    operation(shader, data, false, ivec3(0), data->getSize());
+}
+
+void SlabOperation::operation(Shader& shader, DataTexturePair* data, bool ghost, ivec3 offset, ivec3 end) {
+    copyOutsideRegions(data);
+    GLuint program = useProgram(shader, data, ghost);
+    if(program == 0)
+        return;
+    if(operateOn(shader, program, data, operationRegions(data, offset, end)))
+        data->operationFinished();
+}
+
+bool SlabOperation::operateOn(Shader& shader, GLuint program, DataTexturePair* data,
+        const std::vector<SlabRegion>& parts) {
+    shader.bindUniformBlocks();
+
+    if(computes(data)) {
+        SlabUniforms uniforms = slabUniforms(shader, program);
+        data->bindToImage(0);
+        for(const SlabRegion& part : parts) {
+            if(!dispatch(program, uniforms, part.offset, part.end))
+                return false;
+        }
+    } else if(data->isFlat()) {
+        SlabUniforms uniforms = slabUniforms(shader, program);
+        for(const SlabRegion& part : parts) {
+            if(!drawFlat(uniforms, data, part.offset, part.end))
+                return false;
+        }
+    } else {
+        int depthHandle = shader.uniformHandle("depth");
+        for(const SlabRegion& part : parts) {
+            for(int depth = part.offset.z; depth < part.end.z; depth++) {
+
+                data->bindToFramebuffer(depth);
+                if(!drawLayer(shader, depthHandle, depth, ivec2(part.offset), ivec2(part.end)))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::vector<SlabRegion> SlabOperation::operationRegions(DataTexturePair* data, ivec3 offset, ivec3 end) {
+    if(!restricted || data->getSize() != restrictedSize)
+        return std::vector<SlabRegion>(1, SlabRegion{offset, end});
+
+    std::vector<SlabRegion> parts;
+    for(SlabRegion& region : regions) {
+        SlabRegion part = {max(offset, region.offset), min(end, region.end)};
+        if(all(lessThan(part.offset, part.end)))
+            parts.push_back(part);
+    }
+    return parts;
+}
+
+// Returns boxes that cover the cells of the regions that are outside of all the others
+// Both lists must be sorted along z and not overlap in z, like the regions of restrictOperations()
+static std::vector<SlabRegion> subtractRegions(const std::vector<SlabRegion>& regions,
+        const std::vector<SlabRegion>& others) {
+    std::vector<SlabRegion> result;
+    for(const SlabRegion& region : regions) {
+        // The region is split along z where the others start or end, so that each part overlaps at most one of them
+        std::vector<int> cuts = {region.offset.z, region.end.z};
+        for(const SlabRegion& other : others) {
+            if(other.offset.z > region.offset.z && other.offset.z < region.end.z)
+                cuts.push_back(other.offset.z);
+            if(other.end.z > region.offset.z && other.end.z < region.end.z)
+                cuts.push_back(other.end.z);
+        }
+        std::sort(cuts.begin(), cuts.end());
+
+        for(size_t i = 0; i + 1 < cuts.size(); i++) {
+            if(cuts[i] == cuts[i + 1])
+                continue;
+            ivec3 offset = ivec3(ivec2(region.offset), cuts[i]);
+            ivec3 end = ivec3(ivec2(region.end), cuts[i + 1]);
+            ivec2 overlapOffset = ivec2(end), overlapEnd = ivec2(end);
+            for(const SlabRegion& other : others) {
+                if(other.offset.z <= offset.z && other.end.z > offset.z) {
+                    overlapOffset = clamp(ivec2(other.offset), ivec2(offset), ivec2(end));
+                    overlapEnd = clamp(ivec2(other.end), overlapOffset, ivec2(end));
+                }
+            }
+
+            // The part around the overlap, as the columns on either side and the rows above and below it
+            SlabRegion parts[] = {
+                    {offset, ivec3(overlapOffset.x, end.y, end.z)},
+                    {ivec3(overlapEnd.x, offset.y, offset.z), end},
+                    {ivec3(overlapOffset.x, offset.y, offset.z), ivec3(overlapEnd.x, overlapOffset.y, end.z)},
+                    {ivec3(overlapOffset.x, overlapEnd.y, offset.z), ivec3(overlapEnd.x, end.y, end.z)}};
+            for(const SlabRegion& part : parts) {
+                if(all(lessThan(part.offset, part.end)))
+                    result.push_back(part);
+            }
+        }
+    }
+    return result;
+}
+
+void SlabOperation::copyOutsideRegions(DataTexturePair* data) {
+    if(!restricted || data->getSize() != restrictedSize) {
+        restrictedFields.erase(data);
+        return;
+    }
+
+    // A field that was last operated on without the restriction was covered as a whole
+    auto last = restrictedFields.find(data);
+    std::vector<SlabRegion> covered = last != restrictedFields.end() ? last->second
+            : std::vector<SlabRegion>(1, SlabRegion{ivec3(0), data->getSize()});
+    restrictedFields[data] = regions;
+    std::vector<SlabRegion> parts = subtractRegions(covered, regions);
+    if(parts.empty())
+        return;
+
+    restrictionCopyShader.use();
+    data->bindData(RESTRICTION_SOURCE_SLOT);
+    GLuint program = useProgram(restrictionCopyShader, data, false);
+    if(program != 0)
+        operateOn(restrictionCopyShader, program, data, parts);
+}
+
+void SlabOperation::restrictOperations(ivec3 size, const std::vector<SlabRegion>& regions) {
+    restricted = true;
+    restrictedSize = size;
+    this->regions = regions;
+}
+
+void SlabOperation::unrestrictOperations() {
+    restricted = false;
+    regions.clear();
+}
+
+void SlabOperation::copy(DataTexturePair* source, DataTexturePair* target) {
     copyShader.use();
     source->bindData(GL_TEXTURE0);
 
-    ivec3 size = source->getSize();
-    for(int depth = 0; depth < size.z; depth++){
-        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target, 0, depth);
+    fullOperation(copyShader, target);
+}
 
-        if(!drawLayer(copyShader, depth, size))
-            return;
+bool SlabOperation::computes(DataTexturePair* data) {
+    return useCompute && data->getPrecision() != Precision::unorm8;
+}
+
+GLuint SlabOperation::useProgram(Shader& shader, DataTexturePair* data, bool ghost, bool inPlace) {
+    SlabShaderSource& source = sources[shader.program()];
+    unsigned flatUnits = 0;
+    ivec4 tilings[TILED_TEXTURE_UNITS];
+    for(int unit = 0; unit < TILED_TEXTURE_UNITS; unit++) {
+        tilings[unit] = getTextureTiling(unit);
+        if((source.samplerUnits >> unit & 1u) && tilings[unit] != ivec4(0))
+            flatUnits |= 1u << unit;
     }
+
+    bool compute = computes(data);
+    int index = variantIndex(ghost, compute, data->getType(), flatUnits, data->isFlat(), inPlace);
+    GLuint program = index == 0 ? shader.program() : shader.variant(index);
+    if(program == 0) {
+        // Variants that compute the boundary of optional passes are not needed right away, so they are compiled in
+        // the background like the passes themselves. Those of the other shaders are needed for the boundary to be
+        // set at all, so they are compiled right away.
+        bool async = ghost && source.async;
+        std::pair<GLuint, int> key(shader.program(), index);
+        auto pending = pendingVariants.find(key);
+        if(pending == pendingVariants.end()) {
+            if(async)
+                LOG_INFO("Leaving the boundary of %s as is until its variant is compiled", source.fragmentPath.c_str());
+            std::string fragment = ghost ? fragmentToGhost(source.fragment) : source.fragment;
+            std::string name = source.fragmentPath + " (variant " + std::to_string(index) + ")";
+            Shader& variant = pendingVariants[key];
+            if(compute) {
+                std::string computeSource = fragmentToCompute(fragment, data->getType(), inPlace);
+                if(async ? !variant.loadComputeSourceAsync(computeSource, name.c_str())
+                         : !variant.loadComputeSource(computeSource, name.c_str()))
+                    return 0;
+            } else {
+                std::string flat = fragmentToFlat(fragment, flatUnits, data->isFlat());
+                if(async ? !variant.loadFragmentSourceAsync(source.vertexPath.c_str(), flat, name.c_str())
+                         : !variant.loadFragmentSource(source.vertexPath.c_str(), flat, name.c_str()))
+                    return 0;
+            }
+            pending = pendingVariants.find(key);
+        }
+
+        // A variant that failed to compile stays pending, so that it isn't compiled again
+        if(!pending->second.isReady() || pending->second.program() == 0)
+            return 0;
+        program = pending->second.release();
+        pendingVariants.erase(pending);
+        shader.addVariant(index, program);
+    }
+
+    glUseProgram(program);
+    if(flatUnits != 0)
+        glUniform4iv(shader.uniformLocation(shader.uniformHandle("slab_tiling"), program), TILED_TEXTURE_UNITS,
+                value_ptr(tilings[0]));
+    return program;
+}
+
+SlabUniforms SlabOperation::slabUniforms(Shader& shader, GLuint program) {
+    SlabUniforms uniforms;
+    uniforms.size = shader.uniformLocation(shader.uniformHandle("slab_size"), program);
+    uniforms.boundaryScale = shader.uniformLocation(shader.uniformHandle("slab_boundaryScale"), program);
+    uniforms.parity = shader.uniformLocation(shader.uniformHandle("slab_parity"), program);
+    uniforms.offset = shader.uniformLocation(shader.uniformHandle("slab_offset"), program);
+    uniforms.end = shader.uniformLocation(shader.uniformHandle("slab_end"), program);
+    uniforms.target = shader.uniformLocation(shader.uniformHandle("slab_target"), program);
+    return uniforms;
 }
 
-bool SlabOperation::drawLayer(Shader shader, int depth, ivec3 size) {
+bool SlabOperation::drawFlat(const SlabUniforms& uniforms, DataTexturePair* data, ivec3 offset, ivec3 end) {
+    data->bindToFramebuffer(0);
     if(!checkFramebufferStatus(GL_FRAMEBUFFER, "fire.simulation"))
         return false;
     clearGLErrors("slab operation");
-    glViewport(0, 0, size.x, size.y);
+    // Only the rows of tiles with the layers that are operated on are drawn
+    ivec2 flatSize = data->getFlatSize();
+    ivec4 tiling = data->getTiling();
+    int firstRow = offset.z / tiling.w;
+    int lastRow = (end.z - 1) / tiling.w;
+    glViewport(0, firstRow * tiling.y, flatSize.x, (lastRow - firstRow + 1) * tiling.y);
     glBindVertexArray(interiorVAO);
 
-    shader.uniform1i("depth", depth);
-    //shader.use();
+    glUniform3i(uniforms.offset, offset.x, offset.y, offset.z);
+    glUniform3i(uniforms.end, end.x, end.y, end.z);
+    glUniform4iv(uniforms.target, 1, value_ptr(data->getTiling()));
+
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
     return checkGLError("slab operation");
 }
 
-bool SlabOperation::drawLayerInterior(Shader shader, int depth, ivec3 size) {
-    if(!checkFramebufferStatus(GL_FRAMEBUFFER, "fire.simulation"))
-        return false;
+bool SlabOperation::dispatch(GLuint program, const SlabUniforms& uniforms, ivec3 offset, ivec3 end,
+        bool checkerboard) {
     clearGLErrors("slab operation");
-    glViewport(1, 1, size.x - 2, size.y - 2);
-    glBindVertexArray(interiorVAO);
-
-    shader.uniform1i("depth", depth);
-
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glUseProgram(program);
+    glUniform3i(uniforms.offset, offset.x, offset.y, offset.z);
+    glUniform3i(uniforms.end, end.x, end.y, end.z);
+
+    ivec3 cells = end - offset;
+    if(checkerboard)
+        cells.x = (cells.x + 1) / 2;
+    ivec3 groups = (cells + ivec3(SLAB_GROUP_SIZE - 1)) / SLAB_GROUP_SIZE;
+    glDispatchCompute(groups.x, groups.y, groups.z);
+    // The result is read by texture fetches in the following operations, and by framebuffer clears
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
     return checkGLError("slab operation");
 }
 
-bool SlabOperation::drawLayerBoundary(Shader shader, int depth, ivec3 size) {
+bool SlabOperation::drawLayer(Shader& shader, int depthHandle, int depth, ivec2 offset, ivec2 end) {
     if(!checkFramebufferStatus(GL_FRAMEBUFFER, "fire.simulation"))
         return false;
     clearGLErrors("slab operation");
-    glViewport(0, 0, size.x, size.y);
-    glBindVertexArray(boundaryVAO);
-    glLineWidth(1.99f);
+    glViewport(offset.x, offset.y, end.x - offset.x, end.y - offset.y);
+    glBindVertexArray(interiorVAO);
 
-    shader.uniform1i("depth", depth);
+    shader.uniform1i(depthHandle, depth);
 
-    glDrawElements(GL_LINE_LOOP, 4, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
     return checkGLError("slab operation");
-}
\ No newline at end of file
+}
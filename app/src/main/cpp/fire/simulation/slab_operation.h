@@ -13,6 +13,39 @@
 #include "fire/util/simple_framebuffer.h"
 #include "fire/util/data_texture_pair.h"
 
+#include <map>
+#include <string>
+#include <vector>
+
+// Work group size used along each axis by compute slab operations
+#define SLAB_GROUP_SIZE 4
+
+// Texture slot that cells outside of the regions of restricted operations are copied from, see restrictOperations()
+// It is not used by any operation, so that the copy doesn't replace their inputs
+#define RESTRICTION_SOURCE_SLOT GL_TEXTURE7
+
+// A box of the cells of a field, from offset up to (but not including) end
+struct SlabRegion {
+    ivec3 offset;
+    ivec3 end;
+};
+
+// The sources of a slab operation shader, kept to generate its variants
+struct SlabShaderSource {
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string fragment;
+    // Bit mask of the texture units that the fragment shader samples from
+    unsigned samplerUnits;
+    // Whether the shader was loaded with loadAsync(), in which case its boundary variants are compiled in the background
+    bool async;
+};
+
+// Locations of the uniforms that the generated variants of a slab shader add, in one of its programs
+struct SlabUniforms {
+    GLint size, boundaryScale, parity, offset, end, target;
+};
+
 class SlabOperation {
 
     // Framebuffer
@@ -23,23 +56,54 @@ class SlabOperation {
 
     bool doBoundary = false;
 
+    // Whether operations run as compute dispatches instead of per-layer draws
+    bool useCompute = false;
+
     // interior
     GLuint interiorVAO;
     GLuint interiorPositionBuffer;
     GLuint interiorIndexBuffer;
 
-    // boundary
-    GLuint boundaryVAO;
-    GLuint boundaryPositionBuffer;
-
-    // front and back face
-    Shader FABInteriorShader;
-    Shader FABBoundaryShader;
-    Shader boundaryShader;
     Shader copyShader;
+    // Same as the copy shader, but reads from RESTRICTION_SOURCE_SLOT
+    Shader restrictionCopyShader;
+
+    // indexed by the program of the shader
+    std::map<GLuint, SlabShaderSource> sources;
+
+    // Variants that are compiled in the background, indexed by the program of their shader and the variant index
+    std::map<std::pair<GLuint, int>, Shader> pendingVariants;
+
+    // The regions that operations on fields of the restricted size are limited to, see restrictOperations()
+    bool restricted = false;
+    ivec3 restrictedSize;
+    std::vector<SlabRegion> regions;
+    // The regions that the last operation on each field was restricted to, for fields where it was
+    std::map<DataTexturePair*, std::vector<SlabRegion>> restrictedFields;
 
 public:
-    int init();
+    int init(Settings* settings);
+
+    // Loads a slab operation shader. Variants of it for the compute backend, fields in the flat layout and
+    // operations that compute the boundary are generated from the fragment shader the first time they are needed,
+    // which is why it should not declare any other outputs. The variants keep the defines that the shader is
+    // specialized with, see loadShaderSource().
+    int load(Shader& shader, const char* vertex_path, const char* fragment_path,
+            const ShaderDefines& defines = ShaderDefines());
+
+    // Same as load(), but returns as soon as compiling has started, see Shader::isReady()
+    // Meant for optional passes, whose variants that compute the boundary are also compiled in the background
+    int loadAsync(Shader& shader, const char* vertex_path, const char* fragment_path,
+            const ShaderDefines& defines = ShaderDefines());
+
+    // Same as load(), or loadAsync() if async is set, but for a fragment shader that has already been read or generated
+    // The name is only used for logging
+    int loadSource(Shader& shader, const char* vertex_path, const std::string& fragment, const char* name,
+            bool async = false);
+
+    // Returns the layout that fields of the given resolution should be created with
+    // Falls back to the volume layout if the flat layout is not supported by the backend or the field is too large
+    FieldLayout fieldLayout(Settings* settings, Resolution res);
 
     // Called at the beginning of a series of operations to prepare opengl
     void prepare();
@@ -49,37 +113,83 @@ public:
 
     // Performs the operation with the set shader over the entirety of the given data.
     // You must set the shader program, along with any uniform input or textures needed by the shader beforehand.
-    void fullOperation(Shader shader, DataTexturePair* data);
+    void fullOperation(Shader& shader, DataTexturePair* data);
 
     // Performs the operation with the set shader over the interior of the given data.
+    // With boundaries enabled, the boundary is set in the same operation, to the interior scaled by boundaryScale.
+    // For shaders loaded with loadAsync(), the variant that does this is compiled in the background, and the boundary
+    // is left as is until it is ready.
     // You must set the shader program, along with any uniform input or textures needed by the shader beforehand.
-    void interiorOperation(Shader shader, DataTexturePair* data, int boundaryScale);
+    void interiorOperation(Shader& shader, DataTexturePair* data, int boundaryScale);
 
-    // Target texture is assumed to be of the same size as source
-    void copy(DataTexturePair* source, GLuint target);
+    // Performs a checkerboard operation, which only changes the cells whose coordinates sum to the given parity
+    // modulo 2 and keeps the others as they are, over the interior of the given data like interiorOperation().
+    // The parity is set as the uniform parity of the shader. With the compute backend, scalar fields are updated
+    // in place by a variant that only runs the cells of the parity, otherwise the whole field is operated on.
+    void checkerboardOperation(Shader& shader, DataTexturePair* data, int boundaryScale, int parity);
+
+    // Copies the data of the source to the data of the target
+    // Target is assumed to be of the same size as source
+    void copy(DataTexturePair* source, DataTexturePair* target);
 
     void boundaryMode(BoundaryType mode);
 
+    // Limits the following operations on fields of the given size to the given regions, which must be sorted along z
+    // and not overlap in z. The cells outside of them keep their values: before a field is operated on, the cells
+    // that its last operation covered but the regions don't are copied from its data to its result.
+    void restrictOperations(ivec3 size, const std::vector<SlabRegion>& regions);
+
+    // Lifts the limit of restrictOperations(), so that operations cover whole fields again
+    void unrestrictOperations();
+
 private:
-    void initLine();
     void initQuad();
     int initShaders();
 
-    void setBoundary(DataTexturePair* data, int scale);
+    // Returns whether operations on the field run as compute dispatches, which isn't the case for unorm8 fields
+    // even with the compute backend, since they have no image format
+    bool computes(DataTexturePair* data);
+
+    // Performs the operation over the cells from offset up to (but not including) end
+    // If ghost is set, the variant that also computes the boundary is used
+    void operation(Shader& shader, DataTexturePair* data, bool ghost, ivec3 offset, ivec3 end);
+
+    // Returns the parts of the cells from offset up to (but not including) end of the data that should be operated on
+    std::vector<SlabRegion> operationRegions(DataTexturePair* data, ivec3 offset, ivec3 end);
+
+    // Copies the cells that the last operation on the data covered, but that the restricted regions don't, from its
+    // data to its result, so that they have the same value in both once the pair is swapped
+    // Must be called before the program of the operation is used, since it uses a program of its own
+    void copyOutsideRegions(DataTexturePair* data);
+
+    // Draws or dispatches the program, which is a variant of the shader, over the given parts of the data
+    // Returns true if the operation succeeded without an error
+    bool operateOn(Shader& shader, GLuint program, DataTexturePair* data, const std::vector<SlabRegion>& parts);
+
+    // Switches to the program that should be used for the operation, which is a variant of the shader
+    // for the compute backend, if the result or any of the bound input textures are flat, or if ghost is set.
+    // With inPlace set, the compute variant updates the cells of a checkerboard parity in the data texture.
+    // Returns the program, or 0 if a needed variant could not be created or, with ghost set, is still compiling
+    // in the background
+    GLuint useProgram(Shader& shader, DataTexturePair* data, bool ghost, bool inPlace = false);
 
-    bool drawFrontOrBackBoundary(DataTexturePair* data, int scale, int depth);
+    // Returns the locations of the generated uniforms in the program, from the uniforms reflected by the shader
+    SlabUniforms slabUniforms(Shader& shader, GLuint program);
 
-    // Sets the depth uniform on the shader and then draws both the interior and boundary
+    // Draws the cells from offset up to (but not including) end of a flat field with a single draw
     // Returns true if the operation succeeded without an error
-    bool drawLayer(Shader shader, int depth, ivec3 size);
+    bool drawFlat(const SlabUniforms& uniforms, DataTexturePair* data, ivec3 offset, ivec3 end);
 
-    // Sets the depth uniform on the shader and then draws the interior
+    // Runs the compute program over the cells from offset up to (but not including) end
+    // The result image must already be bound to image unit 0
+    // With checkerboard set, only half of the cells along x are dispatched, for an in place variant
     // Returns true if the operation succeeded without an error
-    bool drawLayerInterior(Shader shader, int depth, ivec3 size);
+    bool dispatch(GLuint program, const SlabUniforms& uniforms, ivec3 offset, ivec3 end, bool checkerboard = false);
 
-    // Sets the depth uniform on the shader and then draws the boundary
+    // Sets the depth uniform, given by its handle, on the shader and then draws the cells of the layer
+    // from offset up to (but not including) end
     // Returns true if the operation succeeded without an error
-    bool drawLayerBoundary(Shader shader, int depth, ivec3 size);
+    bool drawLayer(Shader& shader, int depthHandle, int depth, ivec2 offset, ivec2 end);
 };
 
 #endif //DATX02_20_21_SLAB_OPERATION_H
@@ -5,6 +5,7 @@
 #include "wavelet_turbulence.h"
 
 #include "slab_operation.h"
+#include "field_initialization.h"
 
 #include <stdio.h>
 
@@ -37,17 +38,34 @@ int WaveletTurbulence::init(SlabOperation* slab, Settings* settings) {
 
 int WaveletTurbulence::initShaders() {
     bool success = true;
-    success &= turbulenceShader.load("shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/turbulence.frag");
-    success &= waveletShader.load("shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/wavelet.frag");
-    success &= synthesisShader.load("shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/fluid_synthesis.frag");
-    success &= textureCoordShader.load("shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/advection.frag");
-    success &= energyShader.load("shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/energy_spectrum.frag");
-    success &= regenerateShader.load("shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/regeneration.frag");
-    success &= eigenShader.load("shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/eigenCalculator.frag");
-    success &= jacobianShader.load("shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/jacobianCalculator.frag");
+    // Only the synthesis is needed before the turbulence is ready, the rest are compiled in the background
+    success &= slab->loadAsync(turbulenceShader, "shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/turbulence.frag");
+    success &= slab->loadAsync(waveletShader, "shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/wavelet.frag");
+    success &= slab->loadAsync(textureCoordShader, "shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/advection.frag");
+    success &= slab->loadAsync(energyShader, "shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/energy_spectrum.frag");
+    success &= slab->loadAsync(regenerateShader, "shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/regeneration.frag");
+    success &= slab->loadAsync(eigenShader, "shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/eigenCalculator.frag");
+    success &= slab->loadAsync(jacobianShader, "shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/jacobianCalculator.frag");
+    success &= slab->load(synthesisShader, "shaders/simulation/wavelet/turbulence.vert", "shaders/simulation/wavelet/fluid_synthesis.frag");
     return success;
 }
 
+bool WaveletTurbulence::isReady() {
+    if(generatedNoise > 3)
+        return true;
+
+    Shader* shaders[] = {&turbulenceShader, &waveletShader, &textureCoordShader, &energyShader,
+                         &regenerateShader, &eigenShader, &jacobianShader};
+    for(Shader* shader : shaders) {
+        // A shader that failed to compile leaves the turbulence disabled
+        if(!shader->isReady() || shader->program() == 0)
+            return false;
+    }
+
+    GenerateWavelet();
+    return generatedNoise > 3;
+}
+
 void WaveletTurbulence::initTextures(Settings* settings) {
     ivec3 lowResSize = settings->getSize(Resolution::velocity);
     ivec3 highResSize = settings->getSize(Resolution::substance);
@@ -67,20 +85,30 @@ void WaveletTurbulence::initTextures(Settings* settings) {
     else
         band_max = settings->getMaxBand();
 
-    texture_coord = createVectorDataPair(nullptr, lowResSize, lowScaleFactor);
-    energy = createScalarDataPair(nullptr, lowResSize, lowScaleFactor);
+    FieldLayout lowResLayout = slab->fieldLayout(settings, Resolution::velocity);
+    FieldLayout highResLayout = slab->fieldLayout(settings, Resolution::substance);
 
-    wavelet_turbulence = createVectorDataPair(nullptr, highResSize, highScaleFactor);
-    noiseTexture1 = createScalarDataPair(nullptr, highResSize, highScaleFactor);
-    noiseTexture2 = createScalarDataPair(nullptr, highResSize, highScaleFactor);
-    noiseTexture3 = createScalarDataPair(nullptr, highResSize, highScaleFactor);
+    Precision vectorPrecision = settings->getFieldPrecision(FieldKind::vectors);
+    Precision scalarPrecision = settings->getFieldPrecision(FieldKind::scalars);
 
-    jacobianXTexture = createVectorDataPair(nullptr, lowResSize, lowScaleFactor);
-    jacobianYTexture = createVectorDataPair(nullptr, lowResSize, lowScaleFactor);
-    jacobianZTexture = createVectorDataPair(nullptr, lowResSize, lowScaleFactor);
-    eigenTexture = createVectorDataPair(nullptr, lowResSize, lowScaleFactor);
+    texture_coord = createVectorDataPair(nullptr, lowResSize, lowScaleFactor, lowResLayout, vectorPrecision);
+    energy = createScalarDataPair(nullptr, lowResSize, lowScaleFactor, lowResLayout, scalarPrecision);
 
-    GenerateWavelet();
+    wavelet_turbulence = createVectorDataPair(nullptr, highResSize, highScaleFactor, highResLayout, vectorPrecision);
+    noiseTexture1 = createScalarDataPair(nullptr, highResSize, highScaleFactor, highResLayout, scalarPrecision);
+    noiseTexture2 = createScalarDataPair(nullptr, highResSize, highScaleFactor, highResLayout, scalarPrecision);
+    noiseTexture3 = createScalarDataPair(nullptr, highResSize, highScaleFactor, highResLayout, scalarPrecision);
+
+    // The jacobians start out as zero, which makes the fluid synthesis only upsample the velocity
+    vec3* zero = createVectorField(vec3(0.0f), lowResSize);
+    jacobianXTexture = createVectorDataPair(zero, lowResSize, lowScaleFactor, lowResLayout, vectorPrecision);
+    jacobianYTexture = createVectorDataPair(zero, lowResSize, lowScaleFactor, lowResLayout, vectorPrecision);
+    jacobianZTexture = createVectorDataPair(zero, lowResSize, lowScaleFactor, lowResLayout, vectorPrecision);
+    eigenTexture = createVectorDataPair(nullptr, lowResSize, lowScaleFactor, lowResLayout, vectorPrecision);
+    delete[] zero;
+
+    // The noise is generated by the first simulation steps, see isReady()
+    generatedNoise = 0;
 }
 
 void WaveletTurbulence::clearTextures() {
@@ -108,13 +136,14 @@ int WaveletTurbulence::changeSettings(Settings* settings, bool shouldRegenFields
 
 void WaveletTurbulence::GenerateWavelet(){
 
-    slab->prepare();
-
-    LOG_INFO("band_min: %f, band_max: %f", band_min, band_max);
-
-    noise(noiseTexture1, band_min, band_max);
-    noise(noiseTexture2, band_min, band_max);
-    noise(noiseTexture3, band_min, band_max);
+    DataTexturePair* noiseTextures[] = {noiseTexture1, noiseTexture2, noiseTexture3};
+    if(generatedNoise < 3) {
+        if(generatedNoise == 0)
+            LOG_INFO("band_min: %f, band_max: %f", band_min, band_max);
+        noise(noiseTextures[generatedNoise], band_min, band_max);
+        generatedNoise++;
+        return;
+    }
 
     waveletShader.use();
 
@@ -125,9 +154,9 @@ void WaveletTurbulence::GenerateWavelet(){
     noiseTexture3->bindData(GL_TEXTURE2);
 
     slab->interiorOperation(waveletShader, wavelet_turbulence, 0);
+    generatedNoise++;
 
-    slab->finish();
-
+    LOG_INFO("Finished generating wavelet turbulence");
 }
 
 void WaveletTurbulence::noise(DataTexturePair* noiseTexture, float band_min, float band_max){
@@ -173,6 +202,11 @@ vec3* WaveletTurbulence::generateGradients(int num_gradients){
 }
 
 void WaveletTurbulence::waveletStep(DataTexturePair* lowerVelocity, DataTexturePair* higherVelocity, float dt) {
+    if(!isReady()) {
+        fluidSynthesis(lowerVelocity, higherVelocity);
+        return;
+    }
+
     // Advect texture coordinates
     advection(lowerVelocity, dt);
 
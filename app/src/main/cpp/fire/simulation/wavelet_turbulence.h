@@ -55,11 +55,15 @@ class WaveletTurbulence {
     float band_min, band_max;
     bool custom_band_min, custom_band_max;
 
+    // Number of noise textures generated so far, which is one more than their count once they have been combined
+    int generatedNoise;
+
 public:
     int init(SlabOperation* slab, Settings* settings);
 
     int changeSettings(Settings* settings, bool shouldRegenFields);
 
+    // Until the turbulence is ready, the higher velocity is only upsampled from the lower velocity
     void waveletStep(DataTexturePair* lowerVelocity, DataTexturePair* higherVelocity, float dt);
 
 private:
@@ -81,6 +85,11 @@ private:
 
     vec3* generateGradients(int num_gradients);
 
+    // Returns true once the shaders have been compiled and the noise has been generated.
+    // The noise is generated a part at a time by the calls after the shaders are ready, to spread it over several steps.
+    bool isReady();
+
+    // Generates the next noise texture, or combines them once all three have been generated
     void GenerateWavelet();
 
     void noise(DataTexturePair* noiseTexture, float band_min, float band_max);
@@ -25,38 +25,92 @@ DataTexturePair::~DataTexturePair() {
 }
 
 void DataTexturePair::clearData(){
-    bindData(GL_TEXTURE0);
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    for(int i = 0; i < size.z; i++){
-        bindToFramebuffer(i);
-        glClear(GL_COLOR_BUFFER_BIT);
+    // Clears the result texture, and then the data texture after swapping them
+    for(int texture = 0; texture < 2; texture++) {
+        if(isFlat()) {
+            bindToFramebuffer(0);
+            glClear(GL_COLOR_BUFFER_BIT);
+        } else {
+            for(int i = 0; i < size.z; i++){
+                bindToFramebuffer(i);
+                glClear(GL_COLOR_BUFFER_BIT);
+            }
+        }
+        operationFinished();
     }
 }
 
-void DataTexturePair::initScalarData(float scaleFactor, ivec3 size, float* data) {
+void DataTexturePair::initScalarData(float scaleFactor, ivec3 size, float* data, FieldLayout layout, Precision precision) {
     this->scaleFactor = scaleFactor;
     this->size = size;
+    this->layout = layout;
+    this->precision = precision;
     type = SCALAR;
-    createScalar3DTexture(dataTexture, size, data);
-    createScalar3DTexture(resultTexture, size, (float*)nullptr);
+    if(isFlat()) {
+        createScalarFlatTexture(dataTexture, size, data, precision);
+        createScalarFlatTexture(resultTexture, size, (float*)nullptr, precision);
+    } else {
+        createScalar3DTexture(dataTexture, size, data, precision);
+        createScalar3DTexture(resultTexture, size, (float*)nullptr, precision);
+    }
 }
 
-void DataTexturePair::initVectorData(float scaleFactor, ivec3 size, vec3* data) {
+void DataTexturePair::initVectorData(float scaleFactor, ivec3 size, vec3* data, FieldLayout layout, Precision precision) {
     this->scaleFactor = scaleFactor;
     this->size = size;
+    this->layout = layout;
+    this->precision = precision;
     type = VECTOR;
-    createVector3DTexture(dataTexture, size, data);
-    createVector3DTexture(resultTexture, size, (vec3*)nullptr);
+    if(isFlat()) {
+        createVectorFlatTexture(dataTexture, size, data, precision);
+        createVectorFlatTexture(resultTexture, size, (vec3*)nullptr, precision);
+    } else {
+        createVector3DTexture(dataTexture, size, data, precision);
+        createVector3DTexture(resultTexture, size, (vec3*)nullptr, precision);
+    }
+}
+
+void DataTexturePair::initPairData(float scaleFactor, ivec3 size, vec2* data, FieldLayout layout, Precision precision) {
+    this->scaleFactor = scaleFactor;
+    this->size = size;
+    this->layout = layout;
+    this->precision = precision;
+    type = PAIR;
+    if(isFlat()) {
+        createPairFlatTexture(dataTexture, size, data, precision);
+        createPairFlatTexture(resultTexture, size, (vec2*)nullptr, precision);
+    } else {
+        createPair3DTexture(dataTexture, size, data, precision);
+        createPair3DTexture(resultTexture, size, (vec2*)nullptr, precision);
+    }
 }
 
 void DataTexturePair::bindData(GLenum textureSlot) {
     glActiveTexture(textureSlot);
-    glBindTexture(GL_TEXTURE_3D, dataTexture);
+    if(isFlat()) {
+        glBindTexture(GL_TEXTURE_2D, dataTexture);
+        setTextureTiling(textureSlot, getTiling());
+    } else {
+        glBindTexture(GL_TEXTURE_3D, dataTexture);
+        setTextureTiling(textureSlot, ivec4(0));
+    }
 }
 
 void DataTexturePair::bindToFramebuffer(int depth) {
     // attach result texture to framebuffer
-    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, resultTexture, 0, depth);
+    if(isFlat())
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, resultTexture, 0);
+    else glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, resultTexture, 0, depth);
+}
+
+void DataTexturePair::bindToImage(GLuint unit) {
+    GLenum format = type == SCALAR ? GL_R32F : GL_RGBA16F;
+    glBindImageTexture(unit, resultTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, format);
+}
+
+void DataTexturePair::bindDataToImage(GLuint unit) {
+    glBindImageTexture(unit, dataTexture, 0, GL_TRUE, 0, GL_READ_WRITE, GL_R32F);
 }
 
 void DataTexturePair::operationFinished() {
@@ -77,20 +131,47 @@ ivec3 DataTexturePair::getSize() {
     return size;
 }
 
+TextureType DataTexturePair::getType() {
+    return type;
+}
+
+bool DataTexturePair::isFlat() {
+    return layout == FieldLayout::flat;
+}
+
+Precision DataTexturePair::getPrecision() {
+    return precision;
+}
+
+ivec4 DataTexturePair::getTiling() {
+    return ivec4(size, flatTextureTiles(size).x);
+}
+
+ivec2 DataTexturePair::getFlatSize() {
+    return ivec2(size) * flatTextureTiles(size);
+}
+
 float DataTexturePair::toVoxelScaleFactor() {
     return scaleFactor;
 }
 
-DataTexturePair* createScalarDataPair(float* data, ivec3 size, float scaleFactor) {
+DataTexturePair* createScalarDataPair(float* data, ivec3 size, float scaleFactor, FieldLayout layout, Precision precision) {
+
+    DataTexturePair* texturePair = new DataTexturePair();
+    texturePair->initScalarData(scaleFactor, size, data, layout, precision);
+    return texturePair;
+}
+
+DataTexturePair* createVectorDataPair(vec3* data, ivec3 size, float scaleFactor, FieldLayout layout, Precision precision) {
 
     DataTexturePair* texturePair = new DataTexturePair();
-    texturePair->initScalarData(scaleFactor, size, data);
+    texturePair->initVectorData(scaleFactor, size, data, layout, precision);
     return texturePair;
 }
 
-DataTexturePair* createVectorDataPair(vec3* data, ivec3 size, float scaleFactor) {
+DataTexturePair* createPairDataPair(vec2* data, ivec3 size, float scaleFactor, FieldLayout layout, Precision precision) {
 
     DataTexturePair* texturePair = new DataTexturePair();
-    texturePair->initVectorData(scaleFactor, size, data);
+    texturePair->initPairData(scaleFactor, size, data, layout, precision);
     return texturePair;
 }
\ No newline at end of file
@@ -9,9 +9,12 @@
 
 #include <glm/glm.hpp>
 
+#include "fire/settings.h"
+
 using namespace glm;
 
-enum TextureType { SCALAR, VECTOR };
+// PAIR fields are two scalar fields stored together in the first two channels
+enum TextureType { SCALAR, PAIR, VECTOR };
 
 class DataTexturePair {
     float scaleFactor;
@@ -19,6 +22,8 @@ class DataTexturePair {
     GLuint dataTexture, resultTexture;
 
     TextureType type;
+    FieldLayout layout;
+    Precision precision;
 
 public:
     ~DataTexturePair();
@@ -28,11 +33,15 @@ public:
 
     // initiates the textures as scalar fields with the given data
     // it ignores any previous textures, so only call init once per pair!
-    void initScalarData(float scaleFactor, ivec3 size, float* data);
+    void initScalarData(float scaleFactor, ivec3 size, float* data, FieldLayout layout, Precision precision);
 
     // initiates the textures as vector fields with the given data
     // it ignores any previous textures, so only call init once per pair!
-    void initVectorData(float scaleFactor, ivec3 size, vec3* data);
+    void initVectorData(float scaleFactor, ivec3 size, vec3* data, FieldLayout layout, Precision precision);
+
+    // initiates the textures as pair fields with the given data
+    // it ignores any previous textures, so only call init once per pair!
+    void initPairData(float scaleFactor, ivec3 size, vec2* data, FieldLayout layout, Precision precision);
 
     // binds the data to the provided slot
     // The slot should be GL_TEXTURE0 or any larger number, depending on where you need the texture
@@ -41,8 +50,17 @@ public:
     void bindData(GLenum textureSlot);
 
     // binds the result texture to the currently bound framebuffer so that the result is rendered to
+    // with the flat layout, the whole field is bound and the depth is ignored
     void bindToFramebuffer(int depth);
 
+    // binds all layers of the result texture to the given image unit so that a compute shader can write to it
+    // requires the textures to have been created with image texture storage (see setImageTextureStorage())
+    void bindToImage(GLuint unit);
+
+    // binds all layers of the data texture to the given image unit so that a compute shader can update it in place
+    // only scalar fields can be bound, since images that are both read and written must have a single channel
+    void bindDataToImage(GLuint unit);
+
     // signifies that the caller has finished operation step, such that the data and result should swap
     void operationFinished();
 
@@ -54,13 +72,31 @@ public:
 
     ivec3 getSize();
 
+    TextureType getType();
+
+    bool isFlat();
+
+    Precision getPrecision();
+
+    // returns the size of the field together with the number of tiles per row in the flat layout
+    ivec4 getTiling();
+
+    // returns the size of the 2D texture used by the flat layout
+    ivec2 getFlatSize();
+
     float toVoxelScaleFactor();
 };
 
 // creates a scalar data pair with the given data
-DataTexturePair* createScalarDataPair(float* data, ivec3 size, float scaleFactor);
+DataTexturePair* createScalarDataPair(float* data, ivec3 size, float scaleFactor, FieldLayout layout = FieldLayout::volume,
+        Precision precision = Precision::half);
 
 // create a vector data pair with the given data
-DataTexturePair* createVectorDataPair(vec3* data, ivec3 size, float scaleFactor);
+DataTexturePair* createVectorDataPair(vec3* data, ivec3 size, float scaleFactor, FieldLayout layout = FieldLayout::volume,
+        Precision precision = Precision::half);
+
+// create a pair data pair with the given data
+DataTexturePair* createPairDataPair(vec2* data, ivec3 size, float scaleFactor, FieldLayout layout = FieldLayout::volume,
+        Precision precision = Precision::half);
 
 #endif //DATX02_20_21_DATA_TEXTURE_PAIR_H
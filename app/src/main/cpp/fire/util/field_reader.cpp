@@ -0,0 +1,88 @@
+#include "field_reader.h"
+
+#include <vector>
+
+void FieldReader::start(DataTexturePair* data) {
+    if(reading())
+        return;
+
+    size = data->getSize();
+    tiling = data->getTiling();
+    flat = data->isFlat();
+    flatSize = flat ? data->getFlatSize() : ivec2(size);
+    int layers = flat ? 1 : size.z;
+
+    if(readFramebuffer == 0)
+        glGenFramebuffers(1, &readFramebuffer);
+    if(buffer == 0)
+        glGenBuffers(1, &buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+    GLsizeiptr readSize = flatSize.x * flatSize.y * layers * 4 * sizeof(float);
+    if(readSize != bufferSize) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, readSize, nullptr, GL_STREAM_READ);
+        bufferSize = readSize;
+    }
+
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+    if(flat) {
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, data->getDataTexture(), 0);
+        glReadPixels(0, 0, flatSize.x, flatSize.y, GL_RGBA, GL_FLOAT, 0);
+    } else {
+        for(int z = 0; z < size.z; z++) {
+            glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, data->getDataTexture(), 0, z);
+            glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_FLOAT, (void*) (z * size.x * size.y * 4 * sizeof(float)));
+        }
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFramebuffer);
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool FieldReader::reading() {
+    return fence != 0;
+}
+
+bool FieldReader::poll(std::vector<float>& values) {
+    if(!reading())
+        return false;
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if(status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return false;
+    glDeleteSync(fence);
+    fence = 0;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+    const float* texels = (const float*) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bufferSize, GL_MAP_READ_BIT);
+    if(texels == nullptr) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        return false;
+    }
+    values.resize(size.x * size.y * size.z);
+    for(int z = 0; z < size.z; z++) {
+        for(int y = 0; y < size.y; y++) {
+            for(int x = 0; x < size.x; x++) {
+                // The tiles of a flat field are laid out in rows of tiling.w slices
+                int index = flat
+                        ? (z / tiling.w * size.y + y) * flatSize.x + z % tiling.w * size.x + x
+                        : (z * size.y + y) * size.x + x;
+                values[(z * size.y + y) * size.x + x] = texels[index * 4];
+            }
+        }
+    }
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void FieldReader::clear() {
+    if(fence != 0)
+        glDeleteSync(fence);
+    fence = 0;
+    glDeleteBuffers(1, &buffer);
+    glDeleteFramebuffers(1, &readFramebuffer);
+    buffer = 0;
+    bufferSize = 0;
+    readFramebuffer = 0;
+}
@@ -0,0 +1,40 @@
+#ifndef DATX02_20_21_FIELD_READER_H
+#define DATX02_20_21_FIELD_READER_H
+
+#include <GLES3/gl31.h>
+
+#include <vector>
+
+#include "data_texture_pair.h"
+
+// Reads the data of a field back without waiting for the GPU. The data texture is read into a pixel buffer as RGBA
+// floats, which is the format that float framebuffers can always be read in, and the values are taken from the
+// buffer once a fence after the read has been passed. Fields in both the volume and the flat layout can be read.
+class FieldReader {
+    GLuint readFramebuffer = 0;
+    GLuint buffer = 0;
+    GLsizeiptr bufferSize = 0;
+    GLsync fence = 0;
+
+    // The layout of the field that is being read
+    ivec3 size;
+    ivec4 tiling;
+    ivec2 flatSize;
+    bool flat = false;
+
+public:
+    // Starts reading the field, unless a read is already in progress
+    void start(DataTexturePair* data);
+
+    // Returns true if a read is in progress
+    bool reading();
+
+    // Returns true and sets the values of the first channel of every cell, in x, y and then z order, if the read in
+    // progress has finished, which ends it
+    bool poll(std::vector<float>& values);
+
+    // Deletes the buffer and framebuffer, and abandons any read in progress
+    void clear();
+};
+
+#endif //DATX02_20_21_FIELD_READER_H
@@ -15,11 +15,13 @@ class Framebuffer {
     GLuint format,inFormat;
 
     SimpleFramebuffer FBO;
-    GLuint RBO;
+    // 0 if the framebuffer has no depth and stencil buffer
+    GLuint RBO = 0;
     GLuint colorTextureTarget;
 public:
     void create(int width, int height);
-    void create(int width, int height, GLuint outFormat, GLuint inFormat);
+    // Without depthStencil, the framebuffer only has the color texture
+    void create(int width, int height, GLuint outFormat, GLuint inFormat, bool depthStencil = true);
 
     void clear();
 
@@ -0,0 +1,68 @@
+#include "gpu_timer.h"
+
+#include <GLES2/gl2ext.h>
+#include <android/log.h>
+
+#include "helper.h"
+
+#define LOG_TAG "GpuTimer"
+#define LOG_ERROR(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOG_INFO(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+
+bool GpuTimer::init() {
+    supported = hasExtension("GL_EXT_disjoint_timer_query");
+    if(!supported) {
+        LOG_INFO("GPU timer queries are not supported");
+        return false;
+    }
+
+    glGenQueries(GPU_TIMER_QUERIES, queries);
+    next = 0;
+    pending = 0;
+    return true;
+}
+
+void GpuTimer::clear() {
+    if(supported)
+        glDeleteQueries(GPU_TIMER_QUERIES, queries);
+    supported = false;
+}
+
+void GpuTimer::begin() {
+    // Skip the measurement if all queries are still waiting for their results
+    if(!supported || pending == GPU_TIMER_QUERIES)
+        return;
+    glBeginQuery(GL_TIME_ELAPSED_EXT, queries[next]);
+}
+
+void GpuTimer::end() {
+    if(!supported || pending == GPU_TIMER_QUERIES)
+        return;
+    glEndQuery(GL_TIME_ELAPSED_EXT);
+    next = (next + 1) % GPU_TIMER_QUERIES;
+    pending++;
+}
+
+bool GpuTimer::poll(float& milliseconds) {
+    if(!supported || pending == 0)
+        return false;
+    GLuint oldest = queries[(next + GPU_TIMER_QUERIES - pending) % GPU_TIMER_QUERIES];
+
+    GLuint available = GL_FALSE;
+    glGetQueryObjectuiv(oldest, GL_QUERY_RESULT_AVAILABLE, &available);
+    if(!available)
+        return false;
+    pending--;
+
+    GLuint nanoseconds = 0;
+    glGetQueryObjectuiv(oldest, GL_QUERY_RESULT, &nanoseconds);
+
+    // The result is meaningless if something like a change of the GPU frequency happened during the measurement
+    GLint disjoint = GL_FALSE;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    if(disjoint)
+        return false;
+
+    milliseconds = nanoseconds / 1000000.0f;
+    return true;
+}
@@ -0,0 +1,30 @@
+#ifndef DATX02_20_21_GPU_TIMER_H
+#define DATX02_20_21_GPU_TIMER_H
+
+#include <GLES3/gl31.h>
+
+// Number of measurements that can be in flight, which should cover the frames that the GPU lags behind
+#define GPU_TIMER_QUERIES 4
+
+// Measures the time that the GPU spends on the commands between begin() and end(), with GL_EXT_disjoint_timer_query
+// The results arrive a few frames later, and are read without waiting for the GPU
+class GpuTimer {
+    bool supported = false;
+    GLuint queries[GPU_TIMER_QUERIES];
+    int next = 0, pending = 0;
+public:
+
+    // Returns false if the timer queries aren't supported, in which case nothing is measured
+    bool init();
+
+    void clear();
+
+    void begin();
+
+    void end();
+
+    // Returns true and the time in milliseconds of the oldest measurement if its result has arrived
+    bool poll(float& milliseconds);
+};
+
+#endif //DATX02_20_21_GPU_TIMER_H
@@ -8,6 +8,7 @@
 #include <GLES3/gl3ext.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <jni.h>
 #include <android/log.h>
@@ -15,6 +16,7 @@
 #include <android/asset_manager_jni.h>
 #include <iostream>
 #include <algorithm>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/ext/matrix_transform.hpp>
@@ -54,11 +56,81 @@ char *loadFileToMemory(AAssetManager *mgr, const char *filename) {
     return fileContent;
 }
 
-void createScalar3DTexture(GLuint& id, ivec3 size, float* data){
+static bool imageTextureStorage = false;
+
+void setImageTextureStorage(bool enabled) {
+    imageTextureStorage = enabled;
+}
+
+bool usesImageTextureStorage() {
+    return imageTextureStorage;
+}
+
+GLenum fieldFormat(int channels, Precision precision) {
+    if(imageTextureStorage && precision != Precision::unorm8)
+        // R16F and the formats with two channels are not image formats
+        return channels == 1 ? GL_R32F : GL_RGBA16F;
+    switch(precision) {
+        case Precision::unorm8: return channels == 1 ? GL_R8 : channels == 2 ? GL_RG8 : GL_RGBA8;
+        case Precision::full: return channels == 1 ? GL_R32F : channels == 2 ? GL_RG32F : GL_RGBA32F;
+        case Precision::half: break;
+    }
+    return channels == 1 ? GL_R16F : channels == 2 ? GL_RG16F : GL_RGBA16F;
+}
+
+static bool isNormalized(GLenum internalFormat) {
+    return internalFormat == GL_R8 || internalFormat == GL_RG8 || internalFormat == GL_RGBA8;
+}
+
+static int formatChannels(GLenum internalFormat) {
+    switch(internalFormat) {
+        case GL_R8: case GL_R16F: case GL_R32F: return 1;
+        case GL_RG8: case GL_RG16F: case GL_RG32F: return 2;
+        default: return 4;
+    }
+}
+
+static GLenum pixelFormat(GLenum internalFormat) {
+    int channels = formatChannels(internalFormat);
+    return channels == 1 ? GL_RED : channels == 2 ? GL_RG : GL_RGBA;
+}
+
+// Converts values with the given number of channels to pixels of a texture with the given format, where any
+// channels that the values don't have are zero. Normalized formats can only be uploaded as bytes
+static std::vector<GLubyte> toPixels(const float* data, int count, int channels, GLenum internalFormat) {
+    int pixelChannels = formatChannels(internalFormat);
+    std::vector<float> values(count * pixelChannels, 0.0f);
+    for(int i = 0; i < count; i++)
+        std::copy(data + i * channels, data + (i + 1) * channels, values.begin() + i * pixelChannels);
+
+    if(!isNormalized(internalFormat)) {
+        const GLubyte* bytes = (const GLubyte*) values.data();
+        return std::vector<GLubyte>(bytes, bytes + values.size() * sizeof(float));
+    }
+    std::vector<GLubyte> pixels(values.size());
+    for(size_t i = 0; i < values.size(); i++)
+        pixels[i] = (GLubyte) (clamp(values[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+    return pixels;
+}
+
+static void createFieldTexture(GLuint& id, ivec3 size, int channels, const float* data, Precision precision) {
+    GLenum internalFormat = fieldFormat(channels, precision);
+    GLenum format = pixelFormat(internalFormat);
+    GLenum type = isNormalized(internalFormat) ? GL_UNSIGNED_BYTE : GL_FLOAT;
+    std::vector<GLubyte> pixels;
+    if(data != nullptr)
+        pixels = toPixels(data, size.x * size.y * size.z, channels, internalFormat);
 
     glGenTextures(1, &id);
     glBindTexture(GL_TEXTURE_3D, id);
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_R16F, size.x, size.y, size.z, 0, GL_RED, GL_FLOAT, data);
+    if(imageTextureStorage) {
+        glTexStorage3D(GL_TEXTURE_3D, 1, internalFormat, size.x, size.y, size.z);
+        if(data != nullptr)
+            glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, size.x, size.y, size.z, format, type, pixels.data());
+    } else {
+        glTexImage3D(GL_TEXTURE_3D, 0, internalFormat, size.x, size.y, size.z, 0, format, type,
+                data != nullptr ? pixels.data() : nullptr);
+    }
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
@@ -66,16 +138,88 @@ void createScalar3DTexture(GLuint& id, ivec3 size, float* data){
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 }
 
-void createVector3DTexture(GLuint& id, ivec3 size, vec3* data){
+void createScalar3DTexture(GLuint& id, ivec3 size, float* data, Precision precision){
+    createFieldTexture(id, size, 1, data, precision);
+}
+
+void createPair3DTexture(GLuint& id, ivec3 size, vec2* data, Precision precision){
+    createFieldTexture(id, size, 2, (const float*) data, precision);
+}
+
+void createVector3DTexture(GLuint& id, ivec3 size, vec3* data, Precision precision){
+    createFieldTexture(id, size, 3, (const float*) data, precision);
+}
+
+ivec2 flatTextureTiles(ivec3 size) {
+    // Roughly square, to stay within the maximum texture size
+    int tilesPerRow = 1;
+    while(tilesPerRow * tilesPerRow < size.z)
+        tilesPerRow++;
+    return ivec2(tilesPerRow, (size.z + tilesPerRow - 1) / tilesPerRow);
+}
+
+// Copies each z-slice of the field to its tile in the atlas
+template <typename T>
+static T* toFlatLayout(ivec3 size, T* data) {
+    ivec2 atlasSize = ivec2(size) * flatTextureTiles(size);
+    T* flat = new T[atlasSize.x * atlasSize.y]();
+    int tilesPerRow = flatTextureTiles(size).x;
+    for(int z = 0; z < size.z; z++) {
+        ivec2 corner = ivec2(size) * ivec2(z % tilesPerRow, z / tilesPerRow);
+        for(int y = 0; y < size.y; y++)
+            std::copy(data + (z * size.y + y) * size.x, data + (z * size.y + y + 1) * size.x,
+                    flat + (corner.y + y) * atlasSize.x + corner.x);
+    }
+    return flat;
+}
+
+static void createFlatTexture(GLuint& id, ivec3 size, int channels, const float* data, Precision precision) {
+    ivec2 atlasSize = ivec2(size) * flatTextureTiles(size);
+    GLenum internalFormat = fieldFormat(channels, precision);
+    GLenum type = isNormalized(internalFormat) ? GL_UNSIGNED_BYTE : GL_FLOAT;
+    std::vector<GLubyte> pixels;
+    if(data != nullptr)
+        pixels = toPixels(data, atlasSize.x * atlasSize.y, channels, internalFormat);
 
     glGenTextures(1, &id);
-    glBindTexture(GL_TEXTURE_3D, id);  // todo RGB16F is not considered color-renderable in the gles 3.2 specification. Consider switching to RGBA16F
-    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, size.x, size.y, size.z, 0, GL_RGB, GL_FLOAT, data);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, id);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, atlasSize.x, atlasSize.y, 0, pixelFormat(internalFormat),
+            type, data != nullptr ? pixels.data() : nullptr);
+    // Filtering between slices and clamping at the edges of a tile is done in the shaders
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void createScalarFlatTexture(GLuint& id, ivec3 size, float* data, Precision precision) {
+    float* flat = data != nullptr ? toFlatLayout(size, data) : nullptr;
+    createFlatTexture(id, size, 1, flat, precision);
+    delete[] flat;
+}
+
+void createPairFlatTexture(GLuint& id, ivec3 size, vec2* data, Precision precision) {
+    vec2* flat = data != nullptr ? toFlatLayout(size, data) : nullptr;
+    createFlatTexture(id, size, 2, (const float*) flat, precision);
+    delete[] flat;
+}
+
+void createVectorFlatTexture(GLuint& id, ivec3 size, vec3* data, Precision precision) {
+    vec3* flat = data != nullptr ? toFlatLayout(size, data) : nullptr;
+    createFlatTexture(id, size, 3, (const float*) flat, precision);
+    delete[] flat;
+}
+
+static ivec4 textureTilings[TILED_TEXTURE_UNITS];
+
+void setTextureTiling(GLenum textureSlot, ivec4 tiling) {
+    int unit = textureSlot - GL_TEXTURE0;
+    if(unit < TILED_TEXTURE_UNITS)
+        textureTilings[unit] = tiling;
+}
+
+ivec4 getTextureTiling(int unit) {
+    return textureTilings[unit];
 }
 
 void load3DTexture(AAssetManager *mgr, const char *filename, GLsizei width, GLsizei height,
@@ -111,9 +255,21 @@ void load3DTexture(AAssetManager *mgr, const char *filename, GLsizei width, GLsi
     delete[] fileContent;
 }
 
+bool hasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for(int i = 0; i < count; i++) {
+        const char* extension = (const char*) glGetStringi(GL_EXTENSIONS, i);
+        if(extension != nullptr && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
 void bindData(GLuint dataTexture, GLenum textureSlot) {
     glActiveTexture(textureSlot);
     glBindTexture(GL_TEXTURE_3D, dataTexture);
+    setTextureTiling(textureSlot, ivec4(0));
 }
 
 void clearGLErrors(const char* tag) {
@@ -10,10 +10,44 @@
 
 #include <glm/glm.hpp>
 
+#include "fire/settings.h"
+
 using namespace glm;
 
-void createScalar3DTexture(GLuint& id, ivec3 size, float* data);
-void createVector3DTexture(GLuint& id, ivec3 size, vec3* data);
+// Number of texture units that tilings are remembered for
+#define TILED_TEXTURE_UNITS 8
+
+// Returns the internal format of a field with 1, 2 or 3 channels stored with the given precision
+// See comment on Precision for details on the formats
+GLenum fieldFormat(int channels, Precision precision);
+
+// Pair textures hold two scalar fields in their red and green channels
+// Vector textures have a fourth channel, which is zero in the given data
+void createScalar3DTexture(GLuint& id, ivec3 size, float* data, Precision precision = Precision::half);
+void createPair3DTexture(GLuint& id, ivec3 size, vec2* data, Precision precision = Precision::half);
+void createVector3DTexture(GLuint& id, ivec3 size, vec3* data, Precision precision = Precision::half);
+
+// Flat textures store the z-slices of a 3D field as tiles in a 2D texture, with tiles.x slices per row
+// Returns the number of tiles along each axis used for a field of the given size
+ivec2 flatTextureTiles(ivec3 size);
+void createScalarFlatTexture(GLuint& id, ivec3 size, float* data, Precision precision = Precision::half);
+void createPairFlatTexture(GLuint& id, ivec3 size, vec2* data, Precision precision = Precision::half);
+void createVectorFlatTexture(GLuint& id, ivec3 size, vec3* data, Precision precision = Precision::half);
+
+// Remembers the layout of the texture bound to the given slot, so that shaders can be made to address it correctly
+// The tiling is the size of the field together with the number of tiles per row, or zero if the texture is a volume
+void setTextureTiling(GLenum textureSlot, ivec4 tiling);
+// Returns the tiling of the texture bound to the given texture unit index (0 for GL_TEXTURE0 and so on)
+ivec4 getTextureTiling(int unit);
+
+// Makes createScalar3DTexture and createVector3DTexture allocate immutable storage in formats that can be bound
+// with glBindImageTexture (R32F for scalars, RGBA16F otherwise) regardless of the precision, which the compute slab backend needs for
+// writing its results
+void setImageTextureStorage(bool enabled);
+bool usesImageTextureStorage();
+
+// Returns true if the current context supports the named extension
+bool hasExtension(const char* name);
 
 void load3DTexture(AAssetManager *mgr, const char *filename, GLsizei width, GLsizei height,
                    GLsizei depth,GLuint *volumeTexID);
@@ -21,6 +55,7 @@ void load3DTexture(AAssetManager *mgr, const char *filename, GLsizei width, GLsi
 // Binds the given data texture to the given slot
 // The slot should be GL_TEXTURE0 or any larger number, depending on where you need the texture
 // Note that the active texture is left at the given slot after this!
+// The texture is assumed to be a volume
 void bindData(GLuint dataTexture, GLenum textureSlot);
 
 // Clears out any gl errors and logs how many that was cleared (if any)
@@ -0,0 +1,183 @@
+#include "program_cache.h"
+
+#include <GLES3/gl31.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <android/log.h>
+#include <string>
+#include <vector>
+
+#include "helper.h"
+
+#define LOG_TAG "Program cache"
+#define LOG_ERROR(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOG_INFO(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+
+static std::string cacheDirectory;
+
+// Hash of the driver strings, which starts the file name of every binary, or empty if the cache is disabled
+static std::string driverPrefix;
+static bool prepared = false;
+
+// The program binary formats that the driver accepts
+static std::vector<GLint> binaryFormats;
+
+// 64-bit FNV-1a
+static uint64_t hashString(const std::string& data, uint64_t hash = 14695981039346656037ULL) {
+    for(unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static std::string toHex(uint64_t value) {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) value);
+    return hex;
+}
+
+static std::string glString(GLenum name) {
+    const GLubyte* string = glGetString(name);
+    return string != NULL ? (const char*) string : "";
+}
+
+void initProgramCache(const std::string& directory) {
+    cacheDirectory = directory;
+    prepared = false;
+}
+
+// Checks that the cache can be used and removes the binaries of other drivers, and those that haven't been used
+// recently. Loading or storing a binary updates its modification time, which is what the age is measured from.
+// Done the first time the cache is used, since it needs a context
+static bool prepareCache() {
+    if(prepared)
+        return !driverPrefix.empty();
+    prepared = true;
+    driverPrefix.clear();
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if(cacheDirectory.empty() || formats == 0) {
+        LOG_INFO("Program binaries are not cached");
+        return false;
+    }
+    binaryFormats.resize((size_t) formats);
+    glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, binaryFormats.data());
+
+    std::string driver = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" + glString(GL_VERSION);
+    driverPrefix = toHex(hashString(driver));
+
+    DIR* directory = opendir(cacheDirectory.c_str());
+    if(directory == NULL) {
+        LOG_ERROR("Could not open the program cache directory %s", cacheDirectory.c_str());
+        driverPrefix.clear();
+        return false;
+    }
+    time_t now = time(NULL);
+    int pruned = 0;
+    for(dirent* entry = readdir(directory); entry != NULL; entry = readdir(directory)) {
+        std::string name = entry->d_name;
+        bool binary = name.size() > 4 && name.compare(name.size() - 4, 4, ".bin") == 0;
+        if(!binary)
+            continue;
+        std::string path = cacheDirectory + "/" + name;
+        struct stat info;
+        bool stale = stat(path.c_str(), &info) == 0 && now - info.st_mtime > PROGRAM_CACHE_MAX_AGE;
+        if(stale || name.compare(0, driverPrefix.size(), driverPrefix) != 0) {
+            remove(path.c_str());
+            pruned++;
+        }
+    }
+    if(pruned > 0)
+        LOG_INFO("Removed %d unused program binaries", pruned);
+    closedir(directory);
+    return true;
+}
+
+static std::string cachePath(const std::string& sources) {
+    return cacheDirectory + "/" + driverPrefix + "_" + toHex(hashString(sources)) + ".bin";
+}
+
+GLuint loadCachedProgram(const std::string& sources) {
+    if(!prepareCache())
+        return 0;
+
+    std::string path = cachePath(sources);
+    FILE* file = fopen(path.c_str(), "rb");
+    if(file == NULL)
+        return 0;
+
+    GLenum format = 0;
+    std::vector<char> binary;
+    bool read = fread(&format, sizeof(format), 1, file) == 1;
+    if(read) {
+        long start = ftell(file);
+        fseek(file, 0, SEEK_END);
+        binary.resize((size_t) (ftell(file) - start));
+        fseek(file, start, SEEK_SET);
+        read = !binary.empty() && fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+
+    // A format that the driver doesn't accept would be reported as an error, so it isn't passed on
+    bool accepted = false;
+    for(GLint binaryFormat : binaryFormats)
+        accepted = accepted || (GLenum) binaryFormat == format;
+
+    GLuint program = 0;
+    if(read && accepted) {
+        program = glCreateProgram();
+        glProgramBinary(program, format, binary.data(), (GLsizei) binary.size());
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if(!linked) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+
+    // The binary is rejected if the driver has changed without changing its strings, so it is compiled again
+    if(program == 0) {
+        LOG_INFO("Discarding program binary %s", path.c_str());
+        remove(path.c_str());
+    } else {
+        // Marks the binary as used, so that it isn't pruned
+        utime(path.c_str(), NULL);
+    }
+    return program;
+}
+
+void saveCachedProgram(GLuint program, const std::string& sources) {
+    if(!prepareCache())
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0)
+        return;
+
+    GLenum format = 0;
+    std::vector<char> binary((size_t) length);
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    if(!checkGLError("program binary"))
+        return;
+
+    std::string path = cachePath(sources);
+    FILE* file = fopen(path.c_str(), "wb");
+    if(file == NULL) {
+        LOG_ERROR("Could not write program binary %s", path.c_str());
+        return;
+    }
+    bool written = fwrite(&format, sizeof(format), 1, file) == 1
+            && fwrite(binary.data(), 1, (size_t) length, file) == (size_t) length;
+    fclose(file);
+    if(!written) {
+        LOG_ERROR("Could not write program binary %s", path.c_str());
+        remove(path.c_str());
+    }
+}
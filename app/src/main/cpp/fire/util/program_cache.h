@@ -0,0 +1,25 @@
+#ifndef DATX02_20_21_PROGRAM_CACHE_H
+#define DATX02_20_21_PROGRAM_CACHE_H
+
+#include <GLES3/gl31.h>
+#include <string>
+
+// Seconds that a binary is kept without being used
+#define PROGRAM_CACHE_MAX_AGE (7 * 24 * 60 * 60)
+
+// Linked programs are stored as program binaries in the given directory, so that they only have to be compiled
+// once per driver. Binaries are keyed by a hash of the shader sources together with the vendor, renderer and
+// version strings of the driver. The first time the cache is used, binaries of any other driver are removed, along
+// with those that haven't been loaded or stored for PROGRAM_CACHE_MAX_AGE, such as those of edited shaders.
+// The cache is disabled until it is initiated, or if the driver doesn't support any program binary formats.
+void initProgramCache(const std::string& directory);
+
+// Creates a program from the cached binary of the given sources
+// Returns 0 if there is no binary, or if the driver no longer accepts it
+GLuint loadCachedProgram(const std::string& sources);
+
+// Stores the binary of a program linked from the given sources
+// The program should have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+void saveCachedProgram(GLuint program, const std::string& sources);
+
+#endif //DATX02_20_21_PROGRAM_CACHE_H
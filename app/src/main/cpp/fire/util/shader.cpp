@@ -10,22 +10,72 @@
 #include <stdio.h>
 #include <android/log.h>
 #include <string>
+#include <string.h>
 
 #include "helper.h"
-#include "fire/util/file_loader.h"
+#include "program_cache.h"
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 #define LOG_TAG "shader"
 #define LOG_ERROR(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 #define LOG_INFO(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
 
-int Shader::load(const char *vertex_path, const char *fragment_path) {
-    shader_program = createProgram(vertex_path, fragment_path);
-    return shader_program != 0;
+int Shader::load(const char *vertex_path, const char *fragment_path, const ShaderDefines& defines) {
+    return loadFragmentSource(vertex_path, loadShaderSource(fragment_path, defines), fragment_path);
+}
+
+int Shader::load(const char *compute_path, const ShaderDefines& defines) {
+    return loadComputeSource(loadShaderSource(compute_path, defines), compute_path);
+}
+
+int Shader::loadComputeSource(const std::string& compute_source, const char *name) {
+    return loadComputeSourceAsync(compute_source, name) && finishProgram();
+}
+
+int Shader::loadFragmentSource(const char *vertex_path, const std::string& fragment_source, const char *name) {
+    return loadFragmentSourceAsync(vertex_path, fragment_source, name) && finishProgram();
 }
 
-int Shader::load(const char *compute_path) {
-    shader_program = createProgram(compute_path);
-    return shader_program != 0;
+int Shader::loadAsync(const char *vertex_path, const char *fragment_path, const ShaderDefines& defines) {
+    return loadFragmentSourceAsync(vertex_path, loadShaderSource(fragment_path, defines), fragment_path);
+}
+
+int Shader::loadAsync(const char *compute_path, const ShaderDefines& defines) {
+    return loadComputeSourceAsync(loadShaderSource(compute_path, defines), compute_path);
+}
+
+int Shader::loadComputeSourceAsync(const std::string& compute_source, const char *name) {
+    LOG_INFO("Creating compute shader: %s", name);
+    GLenum types[] = {GL_COMPUTE_SHADER};
+    std::string sources[] = {compute_source};
+    return startProgram(1, types, sources, name);
+}
+
+int Shader::loadFragmentSourceAsync(const char *vertex_path, const std::string& fragment_source, const char *name) {
+    LOG_INFO("Creating Vertex shader: %s", vertex_path);
+    LOG_INFO("Creating Fragment shader: %s", name);
+    GLenum types[] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+    std::string sources[] = {loadShaderSource(vertex_path), fragment_source};
+    return startProgram(2, types, sources, name);
+}
+
+bool Shader::isReady() {
+    if (pendingShaders.empty())
+        return true;
+
+    // Without the extension there is no way to tell without waiting, so the program is finished right away
+    static const bool parallelCompile = hasExtension("GL_KHR_parallel_shader_compile");
+    if (parallelCompile) {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(shader_program, GL_COMPLETION_STATUS_KHR, &completed);
+        if (!completed)
+            return false;
+    }
+    finishProgram();
+    return true;
 }
 
 void Shader::use() {
@@ -39,190 +89,341 @@ GLuint Shader::program() {
     return shader_program;
 }
 
-GLuint Shader::createShader(GLenum type, const char *src) {
-    clearGLErrors("shader creation");
-    GLuint shader = glCreateShader(type);
-    if (!shader) {
-        checkGLError("shader creation");
+int Shader::setProgram(GLuint program) {
+    shader_program = program;
+    variants.clear();
+    programs.clear();
+    uniforms.clear();
+    uniformHandles.clear();
+    for (auto& block : blocks)
+        glDeleteBuffers(1, &block.buffer);
+    blocks.clear();
+    if (program == 0)
         return 0;
-    }
 
-    glShaderSource(shader, 1, &src, NULL);
+    programs.push_back(program);
+    reflectUniforms(program, 0);
+    return 1;
+}
 
-    GLint compiled = GL_FALSE;
-    glCompileShader(shader);
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
-    if (!compiled) {
-        GLint infoLogLen = 0;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLen);
-        if (infoLogLen > 0) {
-            GLchar *infoLog = (GLchar *) malloc(infoLogLen);
-            if (infoLog) {
-                glGetShaderInfoLog(shader, infoLogLen, NULL, infoLog);
-                LOG_ERROR("Could not compile %s shader:\n%s\n",
-                          type == GL_VERTEX_SHADER ? "vertex" : "fragment",
-                          infoLog);
-                free(infoLog);
-            }
+void Shader::addVariant(int index, GLuint program) {
+    variants[index] = program;
+    programs.push_back(program);
+    reflectUniforms(program, programs.size() - 1);
+    copyUniforms(program);
+}
+
+void Shader::reflectUniforms(GLuint program, size_t index) {
+    for (auto& uniform : uniforms)
+        uniform.locations.resize(programs.size(), -1);
+
+    // The variants declare the same uniform blocks as the program, so they share its buffers
+    if (index == 0) {
+        GLint blockCount = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+        for (GLuint i = 0; i < (GLuint) blockCount; i++) {
+            GLint binding, size;
+            glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_BINDING, &binding);
+            glGetActiveUniformBlockiv(program, i, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+
+            ShaderUniformBlock block;
+            block.binding = (GLuint) binding;
+            block.data.assign((size_t) size, 0);
+            block.changed = true;
+            glGenBuffers(1, &block.buffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, block.buffer);
+            glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+            blocks.push_back(block);
         }
-        return 0;
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
     }
 
-    return shader;
+    GLint count = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    for (GLuint i = 0; i < (GLuint) count; i++) {
+        GLchar name[64];
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(program, i, sizeof(name), NULL, &size, &type, name);
+        // Arrays are reflected as their first element
+        std::string uniformName(name);
+        size_t bracket = uniformName.find('[');
+        if (bracket != std::string::npos)
+            uniformName.erase(bracket);
+
+        GLint block, offset;
+        glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_BLOCK_INDEX, &block);
+        glGetActiveUniformsiv(program, 1, &i, GL_UNIFORM_OFFSET, &offset);
+
+        auto found = uniformHandles.find(uniformName);
+        if (found == uniformHandles.end()) {
+            ShaderUniform uniform;
+            uniform.type = type;
+            uniform.locations.assign(programs.size(), -1);
+            uniform.block = index == 0 ? block : -1;
+            uniform.offset = offset;
+            found = uniformHandles.insert(std::make_pair(uniformName, (int) uniforms.size())).first;
+            uniforms.push_back(uniform);
+        }
+        if (block < 0)
+            uniforms[found->second].locations[index] = glGetUniformLocation(program, name);
+    }
 }
 
-GLuint Shader::createProgram(const char *compute_path) {
-    GLuint compute_shader = 0;
-    GLuint shaderProgram = 0;
-    GLint linked = GL_FALSE;
+void Shader::copyUniforms(GLuint target) {
+    size_t index = programs.size() - 1;
+    for (auto& uniform : uniforms) {
+        GLint source = uniform.locations[0];
+        GLint location = uniform.locations[index];
+        // Samplers are bound by layout qualifiers and arrays are not used by slab operations
+        if (source < 0 || location < 0)
+            continue;
+
+        GLfloat floats[4];
+        GLint ints[4];
+        switch (uniform.type) {
+            case GL_FLOAT: glGetUniformfv(program(), source, floats); glProgramUniform1fv(target, location, 1, floats); break;
+            case GL_FLOAT_VEC2: glGetUniformfv(program(), source, floats); glProgramUniform2fv(target, location, 1, floats); break;
+            case GL_FLOAT_VEC3: glGetUniformfv(program(), source, floats); glProgramUniform3fv(target, location, 1, floats); break;
+            case GL_FLOAT_VEC4: glGetUniformfv(program(), source, floats); glProgramUniform4fv(target, location, 1, floats); break;
+            case GL_INT: glGetUniformiv(program(), source, ints); glProgramUniform1iv(target, location, 1, ints); break;
+            case GL_INT_VEC2: glGetUniformiv(program(), source, ints); glProgramUniform2iv(target, location, 1, ints); break;
+            case GL_INT_VEC3: glGetUniformiv(program(), source, ints); glProgramUniform3iv(target, location, 1, ints); break;
+            case GL_INT_VEC4: glGetUniformiv(program(), source, ints); glProgramUniform4iv(target, location, 1, ints); break;
+            default: break;
+        }
+    }
+}
 
-    // shader
-    const char *computeSrc;
+GLuint Shader::variant(int index) {
+    auto found = variants.find(index);
+    return found != variants.end() ? found->second : 0;
+}
 
-    std::string compute;
+GLuint Shader::release() {
+    GLuint program = shader_program;
+    shader_program = 0;
+    setProgram(0);
+    return program;
+}
 
-    compute = loadFileFromAssets(compute_path);
-    computeSrc = compute.c_str();
+static const char* shaderTypeName(GLenum type) {
+    return type == GL_VERTEX_SHADER ? "vertex" : type == GL_COMPUTE_SHADER ? "compute" : "fragment";
+}
 
-    LOG_INFO("Creating compute shader: %s", compute_path);
+int Shader::startProgram(int count, const GLenum* types, const std::string* sources, const char *name) {
+    setProgram(0);
 
-    compute_shader = createShader(GL_COMPUTE_SHADER, computeSrc);
-    if (!compute_shader) {
-        glDeleteShader(compute_shader);
-        return 0;
+    std::string cacheSources;
+    for (int i = 0; i < count; i++)
+        cacheSources += std::string(shaderTypeName(types[i])) + "\n" + sources[i] + "\n";
+    GLuint cached = loadCachedProgram(cacheSources);
+    if (cached != 0) {
+        LOG_INFO("Loaded cached program: %s", name);
+        return setProgram(cached);
     }
 
-    // program
-    LOG_INFO("Creating Program: %s", compute_path);
+    LOG_INFO("Creating Program: %s", name);
     clearGLErrors("shader program creation");
     shader_program = glCreateProgram();
     if (!shader_program) {
         checkGLError("shader program creation");
-        glDeleteShader(compute_shader);
         return 0;
     }
-    glAttachShader(shader_program, compute_shader);
-
 
+    // The statuses are only checked in finishProgram(), so that drivers can compile in the background
+    for (int i = 0; i < count; i++) {
+        GLuint shader = glCreateShader(types[i]);
+        const char* source = sources[i].c_str();
+        glShaderSource(shader, 1, &source, NULL);
+        glCompileShader(shader);
+        glAttachShader(shader_program, shader);
+        pendingShaders.push_back(shader);
+        pendingTypes.push_back(types[i]);
+    }
+    glProgramParameteri(shader_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(shader_program);
-    glGetProgramiv(shader_program, GL_LINK_STATUS, &linked);
+
+    pendingSources = cacheSources;
+    pendingName = name;
+    return 1;
+}
+
+int Shader::finishProgram() {
+    if (pendingShaders.empty())
+        return program() != 0;
+
+    GLuint program = shader_program;
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
     if (!linked) {
-        LOG_ERROR("Could not link program");
+        for (size_t i = 0; i < pendingShaders.size(); i++) {
+            GLint compiled = GL_FALSE;
+            glGetShaderiv(pendingShaders[i], GL_COMPILE_STATUS, &compiled);
+            if (compiled)
+                continue;
+            GLint infoLogLen = 0;
+            glGetShaderiv(pendingShaders[i], GL_INFO_LOG_LENGTH, &infoLogLen);
+            if (infoLogLen > 0) {
+                GLchar *infoLog = (GLchar *) malloc(infoLogLen);
+                if (infoLog) {
+                    glGetShaderInfoLog(pendingShaders[i], infoLogLen, NULL, infoLog);
+                    LOG_ERROR("Could not compile %s shader:\n%s\n", shaderTypeName(pendingTypes[i]), infoLog);
+                    free(infoLog);
+                }
+            }
+        }
+
+        LOG_ERROR("Could not link program %s", pendingName.c_str());
         GLint infoLogLen = 0;
-        glGetProgramiv(shader_program, GL_INFO_LOG_LENGTH, &infoLogLen);
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &infoLogLen);
         if (infoLogLen) {
             GLchar *infoLog = (GLchar *) malloc(infoLogLen);
             if (infoLog) {
-                glGetProgramInfoLog(shader_program, infoLogLen, NULL, infoLog);
+                glGetProgramInfoLog(program, infoLogLen, NULL, infoLog);
                 LOG_ERROR("Could not link program:\n%s\n", infoLog);
                 free(infoLog);
             }
         }
-        glDeleteProgram(shader_program);
-        glDeleteShader(compute_shader);
-        return 0;
+        glDeleteProgram(program);
+        program = 0;
     }
 
-    glDeleteShader(compute_shader);
-    return shader_program;
+    for (GLuint shader : pendingShaders)
+        glDeleteShader(shader);
+    pendingShaders.clear();
+    pendingTypes.clear();
 
+    if (program != 0)
+        saveCachedProgram(program, pendingSources);
+    return setProgram(program);
 }
 
-GLuint Shader::createProgram(const char *vertex_path, const char *fragment_path) {
-    GLuint vertex_shader = 0;
-    GLuint fragment_shader = 0;
-    GLuint shaderProgram = 0;
-    GLint linked = GL_FALSE;
-
-    const char *vertexSrc;
-    const char *fragmentSrc;
-
-    std::string vertex;
-    std::string fragment;
-
-    vertex = loadFileFromAssets(vertex_path);
-    vertexSrc = vertex.c_str();
-
-    LOG_INFO("Creating Vertex shader: %s", vertex_path);
-    vertex_shader = createShader(GL_VERTEX_SHADER, vertexSrc);
-    if (!vertex_shader) {
-        glDeleteShader(vertex_shader);
-        glDeleteShader(fragment_shader);
-        return 0;
-    }
+int Shader::uniformHandle(const GLchar *name) {
+    auto found = uniformHandles.find(name);
+    return found != uniformHandles.end() ? found->second : -1;
+}
 
-    fragment = loadFileFromAssets(fragment_path);
-    fragmentSrc = fragment.c_str();
+GLint Shader::uniformLocation(int handle, GLuint program) {
+    if (handle < 0)
+        return -1;
+    for (size_t i = 0; i < programs.size(); i++)
+        if (programs[i] == program)
+            return uniforms[handle].locations[i];
+    return -1;
+}
 
-    LOG_INFO("Creating Fragment shader: %s", fragment_path);
-    fragment_shader = createShader(GL_FRAGMENT_SHADER, fragmentSrc);
-    if (!fragment_shader) {
-        glDeleteShader(vertex_shader);
-        glDeleteShader(fragment_shader);
-        return 0;
-    }
+bool Shader::isInitiated(const GLchar *name) {
+    if (program() != 0)
+        return true;
+    LOG_ERROR("Tried to set uniform %s for a shader that isn't initiated!", name);
+    return false;
+}
 
-    LOG_INFO("Creating Program: %s, %s", vertex_path, fragment_path);
-    clearGLErrors("shader program creation");
-    shader_program = glCreateProgram();
-    if (!shader_program) {
-        checkGLError("shader program creation");
-        glDeleteShader(vertex_shader);
-        glDeleteShader(fragment_shader);
-        return 0;
+bool Shader::writeBlockUniform(const ShaderUniform& uniform, const void* value, size_t size) {
+    if (uniform.block < 0)
+        return false;
+    ShaderUniformBlock& block = blocks[uniform.block];
+    unsigned char* data = &block.data[uniform.offset];
+    if (memcmp(data, value, size) != 0) {
+        memcpy(data, value, size);
+        block.changed = true;
     }
-    glAttachShader(shader_program, vertex_shader);
-    glAttachShader(shader_program, fragment_shader);
+    return true;
+}
 
-    glLinkProgram(shader_program);
-    glGetProgramiv(shader_program, GL_LINK_STATUS, &linked);
-    if (!linked) {
-        LOG_ERROR("Could not link program");
-        GLint infoLogLen = 0;
-        glGetProgramiv(shader_program, GL_INFO_LOG_LENGTH, &infoLogLen);
-        if (infoLogLen) {
-            GLchar *infoLog = (GLchar *) malloc(infoLogLen);
-            if (infoLog) {
-                glGetProgramInfoLog(shader_program, infoLogLen, NULL, infoLog);
-                LOG_ERROR("Could not link program:\n%s\n", infoLog);
-                free(infoLog);
-            }
+void Shader::bindUniformBlocks() {
+    for (auto& block : blocks) {
+        if (block.changed) {
+            glBindBuffer(GL_UNIFORM_BUFFER, block.buffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, block.data.size(), block.data.data());
+            block.changed = false;
         }
-        glDeleteProgram(shader_program);
-        glDeleteShader(vertex_shader);
-        glDeleteShader(fragment_shader);
-        return 0;
+        glBindBufferBase(GL_UNIFORM_BUFFER, block.binding, block.buffer);
     }
-
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
-    return shader_program;
 }
 
 void Shader::uniform1i(const GLchar *name, int value) {
-    if (program() != 0)
-        glUniform1i(glGetUniformLocation(program(), name), value);
-    else
-        LOG_ERROR("Tried to set uniform %s for a shader that isn't initiated!", name);
+    if (isInitiated(name))
+        uniform1i(uniformHandle(name), value);
+}
+
+void Shader::uniform1i(int handle, int value) {
+    if (handle < 0 || writeBlockUniform(uniforms[handle], &value, sizeof(value)))
+        return;
+    const std::vector<GLint>& locations = uniforms[handle].locations;
+    for (size_t i = 0; i < programs.size(); i++)
+        if (locations[i] >= 0)
+            glProgramUniform1i(programs[i], locations[i], value);
 }
 
 void Shader::uniform1f(const GLchar *name, float value) {
-    if (program() != 0)
-        glUniform1f(glGetUniformLocation(program(), name), value);
-    else
-        LOG_ERROR("Tried to set uniform %s for a shader that isn't initiated!", name);
+    if (isInitiated(name))
+        uniform1f(uniformHandle(name), value);
+}
+
+void Shader::uniform1f(int handle, float value) {
+    if (handle < 0 || writeBlockUniform(uniforms[handle], &value, sizeof(value)))
+        return;
+    const std::vector<GLint>& locations = uniforms[handle].locations;
+    for (size_t i = 0; i < programs.size(); i++)
+        if (locations[i] >= 0)
+            glProgramUniform1f(programs[i], locations[i], value);
+}
+
+void Shader::uniform2f(const GLchar *name, vec2 vector) {
+    if (isInitiated(name))
+        uniform2f(uniformHandle(name), vector);
+}
+
+void Shader::uniform2f(int handle, vec2 vector) {
+    if (handle < 0 || writeBlockUniform(uniforms[handle], &vector.x, sizeof(vector)))
+        return;
+    const std::vector<GLint>& locations = uniforms[handle].locations;
+    for (size_t i = 0; i < programs.size(); i++)
+        if (locations[i] >= 0)
+            glProgramUniform2f(programs[i], locations[i], vector.x, vector.y);
 }
 
 void Shader::uniform3f(const GLchar *name, vec3 vector) {
-    if (program() != 0)
-        glUniform3f(glGetUniformLocation(program(), name), vector.x, vector.y, vector.z);
-    else
-        LOG_ERROR("Tried to set uniform %s for a shader that isn't initiated!", name);
+    if (isInitiated(name))
+        uniform3f(uniformHandle(name), vector);
 }
 
-void Shader::uniform3i(const GLchar *name, ivec3 vector){
-    if (program() != 0)
-        glUniform3i(glGetUniformLocation(program(), name), vector.x, vector.y, vector.z);
-    else
-        LOG_ERROR("Tried to set uniform %s for a shader that isn't initiated!", name);
+void Shader::uniform3f(int handle, vec3 vector) {
+    if (handle < 0 || writeBlockUniform(uniforms[handle], &vector.x, sizeof(vector)))
+        return;
+    const std::vector<GLint>& locations = uniforms[handle].locations;
+    for (size_t i = 0; i < programs.size(); i++)
+        if (locations[i] >= 0)
+            glProgramUniform3f(programs[i], locations[i], vector.x, vector.y, vector.z);
+}
+
+void Shader::uniform3i(const GLchar *name, ivec3 vector) {
+    if (isInitiated(name))
+        uniform3i(uniformHandle(name), vector);
+}
+
+void Shader::uniform3i(int handle, ivec3 vector) {
+    if (handle < 0 || writeBlockUniform(uniforms[handle], &vector.x, sizeof(vector)))
+        return;
+    const std::vector<GLint>& locations = uniforms[handle].locations;
+    for (size_t i = 0; i < programs.size(); i++)
+        if (locations[i] >= 0)
+            glProgramUniform3i(programs[i], locations[i], vector.x, vector.y, vector.z);
+}
+
+void Shader::uniformMatrix4f(const GLchar *name, const mat4& matrix) {
+    if (isInitiated(name))
+        uniformMatrix4f(uniformHandle(name), matrix);
+}
+
+void Shader::uniformMatrix4f(int handle, const mat4& matrix) {
+    // Columns of a std140 mat4 are tightly packed vec4s, like a glm mat4
+    if (handle < 0 || writeBlockUniform(uniforms[handle], &matrix[0].x, sizeof(matrix)))
+        return;
+    const std::vector<GLint>& locations = uniforms[handle].locations;
+    for (size_t i = 0; i < programs.size(); i++)
+        if (locations[i] >= 0)
+            glProgramUniformMatrix4fv(programs[i], locations[i], 1, GL_FALSE, &matrix[0].x);
 }
@@ -10,32 +10,140 @@
 
 #include <glm/glm.hpp>
 
+#include <map>
+#include <string>
+#include <vector>
+
+#include "shader_preprocessor.h"
+
 using namespace glm;
 
+// An active uniform of a shader, reflected when the program and its variants are linked
+struct ShaderUniform {
+    GLenum type;
+    // Location in the program and in each variant, in the order they were added, or -1 where it isn't active
+    std::vector<GLint> locations;
+    // Index of the uniform block that the uniform is a member of, or -1 if it is a default block uniform
+    int block;
+    // Byte offset within the uniform block
+    GLint offset;
+};
+
+// A std140 uniform block of a shader, whose members are written to memory and uploaded with a single buffer update
+struct ShaderUniformBlock {
+    GLuint binding;
+    GLuint buffer;
+    std::vector<unsigned char> data;
+    bool changed;
+};
+
 class Shader {
-    GLuint shader_program;
+    GLuint shader_program = 0;
+
+    // Alternative programs of the same operation, such as compute versions of a slab fragment shader
+    std::map<int, GLuint> variants;
+
+    // The program followed by its variants, in the order they were added
+    std::vector<GLuint> programs;
+
+    std::vector<ShaderUniform> uniforms;
+    // Handles of the uniforms, by name
+    std::map<std::string, int> uniformHandles;
+    std::vector<ShaderUniformBlock> blocks;
+
+    // The shaders of a program that is still being compiled and linked, see isReady()
+    std::vector<GLuint> pendingShaders;
+    std::vector<GLenum> pendingTypes;
+    std::string pendingSources;
+    std::string pendingName;
 public:
-    int load(const char* vertex_path, const char* fragment_path);
+    // Shaders are read with loadShaderSource(), so they can include other files and be specialized by the defines
+    int load(const char* vertex_path, const char* fragment_path, const ShaderDefines& defines = ShaderDefines());
+
+    int load(const char* compute_path, const ShaderDefines& defines = ShaderDefines());
+
+    // Loads a compute program from source that has already been read or generated
+    // The name is only used for logging
+    int loadComputeSource(const std::string& compute_source, const char* name);
+
+    // Loads a program from a vertex shader file and fragment source that has already been read or generated
+    // The name is only used for logging
+    int loadFragmentSource(const char* vertex_path, const std::string& fragment_source, const char* name);
 
-    int load(const char* compute_path);
+    // Same as the loads above, except that they return as soon as compiling has started instead of waiting for it.
+    // The program must not be used before isReady() returns true.
+    int loadAsync(const char* vertex_path, const char* fragment_path, const ShaderDefines& defines = ShaderDefines());
+    int loadAsync(const char* compute_path, const ShaderDefines& defines = ShaderDefines());
+    int loadComputeSourceAsync(const std::string& compute_source, const char* name);
+    int loadFragmentSourceAsync(const char* vertex_path, const std::string& fragment_source, const char* name);
+
+    // Returns true once the program has been linked, after which program() is 0 if that failed.
+    // With KHR_parallel_shader_compile this doesn't wait for the driver, otherwise the program is finished right away.
+    bool isReady();
 
     void use();
 
     GLuint program();
 
+    // Adds an alternative program under the given index. Uniforms set through this shader are set on all variants.
+    // The uniforms that have already been set on this shader are copied to the variant.
+    void addVariant(int index, GLuint program);
+
+    // Returns the variant program with the given index, or 0 if there is none
+    GLuint variant(int index);
+
+    // Returns the program and leaves the shader empty, for programs that are added as variants of another shader
+    GLuint release();
+
+    // Returns a handle to the uniform with the given name, which is quicker to set than the name,
+    // or -1 if neither the program nor any of its variants has an active uniform with the name
+    int uniformHandle(const GLchar *name);
+
+    // Returns the location of the uniform with the given handle in the program, which is the shader's own program or
+    // one of its variants, or -1 if it isn't active there
+    GLint uniformLocation(int handle, GLuint program);
+
+    // Uniforms in uniform blocks are only written to memory, and are uploaded by bindUniformBlocks()
     void uniform1i(const GLchar *name, int value);
+    void uniform1i(int handle, int value);
 
     void uniform1f(const GLchar *name, float value);
+    void uniform1f(int handle, float value);
+
+    void uniform2f(const GLchar *name, vec2 vector);
+    void uniform2f(int handle, vec2 vector);
 
     void uniform3f(const GLchar *name, vec3 vector);
+    void uniform3f(int handle, vec3 vector);
 
     void uniform3i(const GLchar *name, ivec3 vector);
+    void uniform3i(int handle, ivec3 vector);
+
+    void uniformMatrix4f(const GLchar *name, const mat4& matrix);
+    void uniformMatrix4f(int handle, const mat4& matrix);
+
+    // Uploads the uniform blocks that have changed since the last call and binds them to their binding points
+    // Must be called before every draw or dispatch, since other shaders may use the same binding points
+    void bindUniformBlocks();
 private:
-    GLuint createShader(GLenum type, const char* src);
+    // Sets the program of the shader and reflects its uniforms
+    int setProgram(GLuint program);
+
+    // Adds the active uniforms of the program to the uniform table, as the program with the given index
+    void reflectUniforms(GLuint program, size_t index);
+
+    // Writes the value of a uniform block member, returns false if the uniform is not in a block
+    bool writeBlockUniform(const ShaderUniform& uniform, const void* value, size_t size);
+
+    bool isInitiated(const GLchar *name);
+
+    // Starts compiling and linking a program from the given shader stages, unless it is cached
+    int startProgram(int count, const GLenum* types, const std::string* sources, const char* name);
 
-    GLuint createProgram(const char *compute_path);
+    // Waits for the started program to be linked, and logs any errors
+    int finishProgram();
 
-    GLuint createProgram(const char* vertex_path, const char* fragment_path);
+    void copyUniforms(GLuint target);
 
 };
 
@@ -0,0 +1,84 @@
+#include "shader_preprocessor.h"
+
+#include <regex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <android/log.h>
+
+#include "file_loader.h"
+
+#define LOG_TAG "Shader preprocessor"
+#define LOG_ERROR(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOG_INFO(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+
+static const std::regex includeDirective("^\\s*#\\s*include\\s+\"([^\"]+)\"\\s*$");
+
+// Joins a path relative to the directory of the including file, and removes the . and .. segments,
+// which the asset manager doesn't resolve
+static std::string resolvePath(const std::string& includer, const std::string& path) {
+    size_t slash = includer.rfind('/');
+    std::string joined = slash == std::string::npos ? path : includer.substr(0, slash + 1) + path;
+
+    std::vector<std::string> segments;
+    size_t start = 0;
+    while(start <= joined.size()) {
+        size_t end = joined.find('/', start);
+        if(end == std::string::npos)
+            end = joined.size();
+        std::string segment = joined.substr(start, end - start);
+        if(segment == "..") {
+            if(!segments.empty())
+                segments.pop_back();
+        } else if(!segment.empty() && segment != ".")
+            segments.push_back(segment);
+        start = end + 1;
+    }
+
+    std::string resolved;
+    for(const std::string& segment : segments)
+        resolved += (resolved.empty() ? "" : "/") + segment;
+    return resolved;
+}
+
+static std::string resolveIncludes(const std::string& path, std::set<std::string>& included) {
+    std::string source = loadFileFromAssets(path.c_str());
+    std::string result;
+    size_t start = 0;
+    while(start < source.size()) {
+        size_t end = source.find('\n', start);
+        if(end == std::string::npos)
+            end = source.size();
+        std::string line = source.substr(start, end - start);
+        start = end + 1;
+
+        std::smatch match;
+        if(line.find("include") == std::string::npos || !std::regex_match(line, match, includeDirective)) {
+            result += line + "\n";
+            continue;
+        }
+        std::string includedPath = resolvePath(path, match[1].str());
+        if(included.insert(includedPath).second)
+            result += resolveIncludes(includedPath, included) + "\n";
+    }
+    return result;
+}
+
+std::string loadShaderSource(const char* path, const ShaderDefines& defines) {
+    std::set<std::string> included;
+    included.insert(path);
+    std::string source = resolveIncludes(path, included);
+    if(defines.empty())
+        return source;
+
+    std::string lines;
+    for(auto& define : defines)
+        lines += "#define " + define.first + " " + define.second + "\n";
+    return injectAfterVersion(source, lines);
+}
+
+std::string injectAfterVersion(const std::string& source, const std::string& lines) {
+    size_t lineEnd = source.find('\n', source.find("#version"));
+    return source.substr(0, lineEnd + 1) + lines + source.substr(lineEnd + 1);
+}
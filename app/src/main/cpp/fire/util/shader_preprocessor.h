@@ -0,0 +1,20 @@
+#ifndef DATX02_20_21_SHADER_PREPROCESSOR_H
+#define DATX02_20_21_SHADER_PREPROCESSOR_H
+
+#include <map>
+#include <string>
+
+// Macros that specialize a shader, by name. A shader loaded with different defines is a different program,
+// which lets the compiler fold the values as constants and drop code that the specialization doesn't need.
+// The map is ordered so that the same defines always give the same source, and with it the same cached binary.
+typedef std::map<std::string, std::string> ShaderDefines;
+
+// Reads a shader from the assets and prepares it for compiling. Lines of the form #include "path" are replaced
+// with the included file, with the path relative to the directory of the including file, and every file is
+// included at most once. The defines are inserted as #define lines directly after the #version line.
+std::string loadShaderSource(const char* path, const ShaderDefines& defines = ShaderDefines());
+
+// Inserts the given lines directly after the #version line of the shader source
+std::string injectAfterVersion(const std::string& source, const std::string& lines);
+
+#endif //DATX02_20_21_SHADER_PREPROCESSOR_H
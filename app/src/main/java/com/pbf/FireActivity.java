@@ -46,7 +46,7 @@ public class FireActivity extends FragmentActivity {
 
         Point dimension = new Point();
         getWindowManager().getDefaultDisplay().getSize(dimension);
-        init(getResources().getAssets(), dimension.x, dimension.y);
+        init(getResources().getAssets(), getCacheDir().getAbsolutePath(), dimension.x, dimension.y);
 
         mainLayout = findViewById(R.id.mainLayout);
 
@@ -193,6 +193,6 @@ public class FireActivity extends FragmentActivity {
         }
     }
 
-    public native void init(AssetManager mgr, int width, int height);
+    public native void init(AssetManager mgr, String cacheDirectory, int width, int height);
 
 }